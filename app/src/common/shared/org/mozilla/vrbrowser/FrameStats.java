@@ -0,0 +1,45 @@
+/* -*- Mode: Java; c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil; -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+package org.mozilla.vrbrowser;
+
+import java.util.Locale;
+
+public class FrameStats {
+    // Must be kept in sync with FrameHistogram.h
+    static final int SnapshotSize = 9;
+
+    public long frames;
+    public long missedFrames;
+    public long droppedFrames;
+    // All times are in milliseconds.
+    public double displayPeriod;
+    public double mean;
+    public double p50;
+    public double p95;
+    public double p99;
+    public double max;
+
+    static FrameStats fromSnapshot(double[] aSnapshot) {
+        FrameStats stats = new FrameStats();
+        stats.frames = (long) aSnapshot[0];
+        stats.missedFrames = (long) aSnapshot[1];
+        stats.droppedFrames = (long) aSnapshot[2];
+        stats.displayPeriod = aSnapshot[3];
+        stats.mean = aSnapshot[4];
+        stats.p50 = aSnapshot[5];
+        stats.p95 = aSnapshot[6];
+        stats.p99 = aSnapshot[7];
+        stats.max = aSnapshot[8];
+        return stats;
+    }
+
+    @Override
+    public String toString() {
+        return String.format(Locale.US,
+                "frames: %d missed: %d dropped: %d period: %.2fms mean: %.2fms p50: %.2fms p95: %.2fms p99: %.2fms max: %.2fms",
+                frames, missedFrames, droppedFrames, displayPeriod, mean, p50, p95, p99, max);
+    }
+}
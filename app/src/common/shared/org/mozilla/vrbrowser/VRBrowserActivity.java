@@ -35,6 +35,9 @@ import org.mozilla.vrbrowser.ui.NavigationBar;
 import org.mozilla.vrbrowser.ui.TabOverflowWidget;
 import org.mozilla.vrbrowser.ui.UIWidget;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.Arrays;
 import java.util.HashMap;
 
 public class VRBrowserActivity extends PlatformActivity implements WidgetManagerDelegate {
@@ -58,7 +61,25 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
     static final int GestureSwipeRight = 1;
     static final int SwipeDelay = 1000; // milliseconds
 
+    // Must be kept in sync with BrowserWorld.cpp
+    static final int EventMotion = 0;
+    static final int EventScroll = 1;
+    static final int EventGesture = 2;
+    // Each event is: type, widget handle, device, value (ints), x, y (floats), then the
+    // CLOCK_MONOTONIC sample time in nanoseconds (long).
+    static final int EventRecordSize = 32;
+    static final int EventBufferCapacity = 1024; // events
+    // Controllers whose pending hover moves may be coalesced.
+    static final int EventCoalesceDevices = 4;
+
+    // Must be kept in sync with FrameTimings.h
+    static final int FrameTimingPhaseCount = 9;
+    // Each frame is reported as: frame index, start time (ns), then one duration (ns) per phase.
+    static final int FrameTimingStride = FrameTimingPhaseCount + 2;
+
     static final String LOGTAG = "VRB";
+    // Float intent extra passed to setLensRadius() on launch.
+    static final String EXTRA_LENS_RADIUS = "lens_radius";
     HashMap<Integer, Widget> mWidgets;
     SparseArray<WidgetAddCallback> mWidgetAddCallbacks;
     private int mWidgetAddCallbackIndex;
@@ -68,7 +89,19 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
     int mLastGesture;
     SwipeRunnable mLastRunnable;
     Handler mHandler = new Handler();
-    Runnable mAudioUpdateRunnable;
+    final Object mEventLock = new Object();
+    ByteBuffer mPendingEvents = ByteBuffer.allocate(EventBufferCapacity * EventRecordSize).order(ByteOrder.nativeOrder());
+    ByteBuffer mDispatchEvents = ByteBuffer.allocate(EventBufferCapacity * EventRecordSize).order(ByteOrder.nativeOrder());
+    boolean mEventsPosted;
+    // Offset in mPendingEvents of each device's last event, if it is a hover move.
+    int[] mPendingHoverOffsets = new int[EventCoalesceDevices];
+    boolean[] mDevicePressed = new boolean[EventCoalesceDevices];
+    Runnable mEventRunnable = new Runnable() {
+        @Override
+        public void run() {
+            dispatchEvents();
+        }
+    };
     BrowserWidget mBrowserWidget;
     KeyboardWidget mKeyboard;
     private boolean mWasBrowserPressed = false;
@@ -94,6 +127,7 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
         super.onCreate(savedInstanceState);
 
         mWidgets = new HashMap<>();
+        Arrays.fill(mPendingHoverOffsets, -1);
         mWidgetAddCallbacks = new SparseArray<>();
         mWidgetContainer = new FrameLayout(this);
         mWidgetContainer.getViewTreeObserver().addOnGlobalFocusChangeListener(new ViewTreeObserver.OnGlobalFocusChangeListener() {
@@ -104,6 +138,12 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
         });
 
         mAudioEngine = new AudioEngine(this, new VRAudioTheme());
+        mAudioEngine.setPoseSource(new AudioEngine.PoseSource() {
+            @Override
+            public int readPose(float[] aPose) {
+                return readAudioPoseNative(aPose);
+            }
+        });
         mAudioEngine.preloadAsync(new Runnable() {
             @Override
             public void run() {
@@ -111,14 +151,11 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
                 // mAudioEngine.playSound(AudioEngine.Sound.AMBIENT, true);
             }
         });
-        mAudioUpdateRunnable = new Runnable() {
-            @Override
-            public void run() {
-                mAudioEngine.update();
-            }
-        };
-
         loadFromIntent(getIntent());
+        final float lensRadius = getIntent().getFloatExtra(EXTRA_LENS_RADIUS, 0.0f);
+        if (lensRadius > 0.0f) {
+            setLensRadius(lensRadius);
+        }
         queueRunnable(new Runnable() {
             @Override
             public void run() {
@@ -298,85 +335,136 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
     }
 
     @Keep
-    void handleMotionEvent(final int aHandle, final int aDevice, final boolean aPressed, final float aX, final float aY) {
-        runOnUiThread(new Runnable() {
-            @Override
-            public void run() {
-                Widget widget = mWidgets.get(aHandle);
-                if (widget != null) {
-                    MotionEventGenerator.dispatch(widget, aDevice, aPressed, aX, aY);
-                } else {
-                    Log.e(LOGTAG, "Failed to find widget: " + aHandle);
-                }
-                // Fixme: Remove this once the new Keyboard delegate lands in GeckoView
-                if (widget == mBrowserWidget) {
-                    if (mWasBrowserPressed != aPressed) {
-                        mHandler.postDelayed(new Runnable() {
-                            @Override
-                            public void run() {
-                                checkKeyboardFocus(mBrowserWidget);
-                            }
-                        }, 150);
-                    }
-                    mWasBrowserPressed = aPressed;
-                }
+    void handleEventBatch(ByteBuffer aEvents, int aCount) {
+        // Called on the render thread. The native buffer is reused for the next
+        // frame, so copy the events out before handing them to the UI thread.
+        aEvents.order(ByteOrder.nativeOrder());
+        synchronized (mEventLock) {
+            for (int offset = 0; offset < aCount * EventRecordSize; offset += EventRecordSize) {
+                appendEvent(aEvents, offset);
             }
-        });
+            if (!mEventsPosted && (mPendingEvents.position() > 0)) {
+                mEventsPosted = true;
+                runOnUiThread(mEventRunnable);
+            }
+        }
     }
 
-    @Keep
-    void handleScrollEvent(final int aHandle, final int aDevice, final float aX, final float aY) {
-        runOnUiThread(new Runnable() {
-            @Override
-            public void run() {
-                Widget widget = mWidgets.get(aHandle);
-                if (widget != null) {
-                    MotionEventGenerator.dispatchScroll(widget, aDevice, aX, aY);
-                } else {
-                    Log.e(LOGTAG, "Failed to find widget: " + aHandle);
-                }
+    // Must be called with mEventLock held.
+    private void appendEvent(ByteBuffer aEvents, int aOffset) {
+        int type = aEvents.getInt(aOffset);
+        int handle = aEvents.getInt(aOffset + 4);
+        int device = aEvents.getInt(aOffset + 8);
+        boolean coalesce = (device >= 0) && (device < EventCoalesceDevices);
+        boolean hover = false;
+        if (coalesce && (type == EventMotion)) {
+            boolean pressed = aEvents.getInt(aOffset + 12) != 0;
+            hover = !pressed && !mDevicePressed[device];
+            mDevicePressed[device] = pressed;
+            // A hover move that the UI thread has not seen yet is replaced by a newer
+            // one over the same widget, keeping the latest position and time.
+            int pending = mPendingHoverOffsets[device];
+            if (hover && (pending >= 0) && (mPendingEvents.getInt(pending + 4) == handle)) {
+                mPendingEvents.putFloat(pending + 16, aEvents.getFloat(aOffset + 16));
+                mPendingEvents.putFloat(pending + 20, aEvents.getFloat(aOffset + 20));
+                mPendingEvents.putLong(pending + 24, aEvents.getLong(aOffset + 24));
+                return;
             }
-        });
+        }
+        if (mPendingEvents.remaining() < EventRecordSize) {
+            Log.e(LOGTAG, "Dropping input event, the UI thread is not keeping up");
+            return;
+        }
+        if (coalesce && (type != EventGesture)) {
+            mPendingHoverOffsets[device] = hover ? mPendingEvents.position() : -1;
+        }
+        for (int index = 0; index < EventRecordSize; index += 4) {
+            mPendingEvents.putInt(aEvents.getInt(aOffset + index));
+        }
     }
 
-    @Keep
-    void handleGesture(final int aType) {
-        runOnUiThread(new Runnable() {
-            @Override
-            public void run() {
-                boolean consumed = false;
-                if ((aType == GestureSwipeLeft) && (mLastGesture == GestureSwipeLeft)) {
-                    Log.e(LOGTAG, "Go BACK!");
-                    SessionStore.get().goBack();
-                    consumed = true;
-                } else if ((aType == GestureSwipeRight) && (mLastGesture == GestureSwipeRight)) {
-                    Log.e(LOGTAG, "Go FORWARD!");
-                    SessionStore.get().goForward();
-                    consumed = true;
-                }
-                if (mLastRunnable != null) {
-                    mLastRunnable.mCanceled = true;
-                    mLastRunnable = null;
-                }
-                if (consumed) {
-                    mLastGesture = NoGesture;
+    private void dispatchEvents() {
+        synchronized (mEventLock) {
+            ByteBuffer events = mPendingEvents;
+            mPendingEvents = mDispatchEvents;
+            mDispatchEvents = events;
+            mEventsPosted = false;
+            Arrays.fill(mPendingHoverOffsets, -1);
+        }
+        mDispatchEvents.flip();
+        while (mDispatchEvents.remaining() >= EventRecordSize) {
+            int type = mDispatchEvents.getInt();
+            int handle = mDispatchEvents.getInt();
+            int device = mDispatchEvents.getInt();
+            int value = mDispatchEvents.getInt();
+            float x = mDispatchEvents.getFloat();
+            float y = mDispatchEvents.getFloat();
+            // MotionEvent times are uptimeMillis(), which is CLOCK_MONOTONIC in milliseconds.
+            long time = mDispatchEvents.getLong() / 1000000L;
+            if (type == EventMotion) {
+                dispatchMotionEvent(handle, device, value != 0, x, y, time);
+            } else if (type == EventScroll) {
+                dispatchScrollEvent(handle, device, x, y, time);
+            } else if (type == EventGesture) {
+                dispatchGesture(value);
+            }
+        }
+        mDispatchEvents.clear();
+    }
 
-                } else {
-                    mLastGesture = aType;
-                    mLastRunnable = new SwipeRunnable();
-                    mHandler.postDelayed(mLastRunnable, SwipeDelay);
-                }
+    private void dispatchMotionEvent(final int aHandle, final int aDevice, final boolean aPressed, final float aX, final float aY, final long aTime) {
+        Widget widget = mWidgets.get(aHandle);
+        if (widget != null) {
+            MotionEventGenerator.dispatch(widget, aDevice, aPressed, aX, aY, aTime);
+        } else {
+            Log.e(LOGTAG, "Failed to find widget: " + aHandle);
+        }
+        // Fixme: Remove this once the new Keyboard delegate lands in GeckoView
+        if (widget == mBrowserWidget) {
+            if (mWasBrowserPressed != aPressed) {
+                mHandler.postDelayed(new Runnable() {
+                    @Override
+                    public void run() {
+                        checkKeyboardFocus(mBrowserWidget);
+                    }
+                }, 150);
             }
-        });
+            mWasBrowserPressed = aPressed;
+        }
     }
 
-    @Keep
-    void handleAudioPose(float qx, float qy, float qz, float qw, float px, float py, float pz) {
-        mAudioEngine.setPose(qx, qy, qz, qw, px, py, pz);
+    private void dispatchScrollEvent(final int aHandle, final int aDevice, final float aX, final float aY, final long aTime) {
+        Widget widget = mWidgets.get(aHandle);
+        if (widget != null) {
+            MotionEventGenerator.dispatchScroll(widget, aDevice, aX, aY, aTime);
+        } else {
+            Log.e(LOGTAG, "Failed to find widget: " + aHandle);
+        }
+    }
 
-        // https://developers.google.com/vr/reference/android/com/google/vr/sdk/audio/GvrAudioEngine.html#resume()
-        // The update method must be called from the main thread at a regular rate.
-        runOnUiThread(mAudioUpdateRunnable);
+    private void dispatchGesture(final int aType) {
+        boolean consumed = false;
+        if ((aType == GestureSwipeLeft) && (mLastGesture == GestureSwipeLeft)) {
+            Log.e(LOGTAG, "Go BACK!");
+            SessionStore.get().goBack();
+            consumed = true;
+        } else if ((aType == GestureSwipeRight) && (mLastGesture == GestureSwipeRight)) {
+            Log.e(LOGTAG, "Go FORWARD!");
+            SessionStore.get().goForward();
+            consumed = true;
+        }
+        if (mLastRunnable != null) {
+            mLastRunnable.mCanceled = true;
+            mLastRunnable = null;
+        }
+        if (consumed) {
+            mLastGesture = NoGesture;
+
+        } else {
+            mLastGesture = aType;
+            mLastRunnable = new SwipeRunnable();
+            mHandler.postDelayed(mLastRunnable, SwipeDelay);
+        }
     }
 
     @Keep
@@ -444,6 +532,21 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
         }
     }
 
+    @Override
+    public void updateWidgets(final int[] aHandles, final WidgetPlacement[] aPlacements) {
+        if (aHandles.length != aPlacements.length) {
+            Log.e(LOGTAG, "updateWidgets: " + aHandles.length + " handles for " + aPlacements.length + " placements");
+            return;
+        }
+        // One native call applies every placement, in array order.
+        queueRunnable(new Runnable() {
+            @Override
+            public void run() {
+                updateWidgetPlacementsNative(aHandles, aPlacements, aHandles.length);
+            }
+        });
+    }
+
     @Override
     public void removeWidget(final int aHandle) {
         Widget widget = mWidgets.remove(aHandle);
@@ -458,9 +561,98 @@ public class VRBrowserActivity extends PlatformActivity implements WidgetManager
         });
     }
 
+    // Returns the most recent native frame timings, oldest first. Safe to call from any thread.
+    public long[] getFrameTimings(int aMaxFrames) {
+        long[] buffer = new long[aMaxFrames * FrameTimingStride];
+        int count = getFrameTimingsNative(buffer);
+        if (count < aMaxFrames) {
+            long[] result = new long[count * FrameTimingStride];
+            System.arraycopy(buffer, 0, result, 0, result.length);
+            return result;
+        }
+        return buffer;
+    }
+
+    public boolean dumpFrameTimings(String aPath) {
+        return dumpFrameTimingsNative(aPath);
+    }
+
+    // Returns the frame time distribution since the last call to resetFrameStats().
+    public FrameStats getFrameStats() {
+        double[] snapshot = new double[FrameStats.SnapshotSize];
+        getFrameStatsNative(snapshot);
+        return FrameStats.fromSnapshot(snapshot);
+    }
+
+    public void resetFrameStats() {
+        resetFrameStatsNative();
+    }
+
+    // Records controller input and head pose to a file that the headless host build can replay.
+    public void startInputRecording(final String aPath) {
+        queueRunnable(new Runnable() {
+            @Override
+            public void run() {
+                startInputRecordingNative(aPath);
+            }
+        });
+    }
+
+    public void stopInputRecording() {
+        queueRunnable(new Runnable() {
+            @Override
+            public void run() {
+                stopInputRecordingNative();
+            }
+        });
+    }
+
+    // Head poses that differ from the last one given to the audio engine by less than
+    // both aRotation (radians) and aDistance (meters) are skipped. Zero skips only
+    // unchanged poses.
+    public void setAudioPoseThreshold(final float aRotation, final float aDistance) {
+        queueRunnable(new Runnable() {
+            @Override
+            public void run() {
+                setAudioPoseThresholdNative(aRotation, aDistance);
+            }
+        });
+    }
+
+    // Masks the eye buffer outside a circle of aRadius, relative to half the eye
+    // viewport, in place of the device's hidden area mesh. Zero turns the mask off.
+    public void setLensRadius(final float aRadius) {
+        queueRunnable(new Runnable() {
+            @Override
+            public void run() {
+                setLensRadiusNative(aRadius);
+            }
+        });
+    }
+
+    // Native trace events are written as Chrome trace-event JSON when tracing stops.
+    public void startTracing() {
+        startTracingNative();
+    }
+
+    public boolean stopTracing(String aPath) {
+        return stopTracingNative(aPath);
+    }
 
     private native void addWidgetNative(WidgetPlacement aWidget, boolean aVisible, int aCallbackId);
     private native void setWidgetVisibleNative(int aHandle, boolean aVisible);
     private native void updateWidgetPlacementNative(int aHandle, WidgetPlacement aPlacement);
+    private native void updateWidgetPlacementsNative(int[] aHandles, WidgetPlacement[] aPlacements, int aCount);
     private native void removeWidgetNative(int aHandle);
+    private native int getFrameTimingsNative(long[] aBuffer);
+    private native boolean dumpFrameTimingsNative(String aPath);
+    private native void getFrameStatsNative(double[] aSnapshot);
+    private native void resetFrameStatsNative();
+    private native void setAudioPoseThresholdNative(float aRotation, float aDistance);
+    private native void setLensRadiusNative(float aRadius);
+    private native int readAudioPoseNative(float[] aPose);
+    private native boolean startInputRecordingNative(String aPath);
+    private native void stopInputRecordingNative();
+    private native void startTracingNative();
+    private native boolean stopTracingNative(String aPath);
 }
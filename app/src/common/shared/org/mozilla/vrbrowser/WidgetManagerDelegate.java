@@ -9,5 +9,7 @@ public interface WidgetManagerDelegate {
 
     void addWidget(WidgetPlacement aPlacement, boolean aVisible, @Nullable WidgetAddCallback aCallback);
     void updateWidget(int aHandle, boolean aVisible, @Nullable WidgetPlacement aPlacement);
+    // Applies all placements in one native call. Parents should come before their children.
+    void updateWidgets(int[] aHandles, WidgetPlacement[] aPlacements);
     void removeWidget(int aHandle);
 }
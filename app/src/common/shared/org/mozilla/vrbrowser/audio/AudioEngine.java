@@ -7,9 +7,12 @@ package org.mozilla.vrbrowser.audio;
 
 import android.app.Activity;
 import android.content.Context;
+import android.os.Handler;
+import android.os.Looper;
 import android.util.Log;
 
 import com.google.vr.sdk.audio.GvrAudioEngine;
+
 import java.util.concurrent.ConcurrentHashMap;
 
 public class AudioEngine {
@@ -20,6 +23,21 @@ public class AudioEngine {
     private float mMasterVolume = 1.0f;
     private static ConcurrentHashMap<Context, AudioEngine> mEngines = new ConcurrentHashMap<>();
     private static final String LOGTAG = "VRB";
+    private static final int PoseUpdatePeriod = 16; // milliseconds
+    private volatile PoseSource mPoseSource;
+    private int mPoseSequence;
+    private float[] mPose = new float[7];
+    private Handler mPoseHandler = new Handler(Looper.getMainLooper());
+    private boolean mPosePolling;
+    private Runnable mPoseRunnable = new Runnable() {
+        @Override
+        public void run() {
+            updatePose();
+            // The update method must be called from the main thread at a regular rate.
+            mEngine.update();
+            mPoseHandler.postDelayed(this, PoseUpdatePeriod);
+        }
+    };
 
     public enum SoundType {
         STEREO,
@@ -47,6 +65,12 @@ public class AudioEngine {
         }
     }
 
+    public interface PoseSource {
+        // Copies the latest head pose into aPose as qx, qy, qz, qw, px, py, pz and returns
+        // its sequence number, or returns -1 if no pose is available.
+        int readPose(float[] aPose);
+    }
+
     public interface AudioTheme {
         String getPath(Sound aSound);
     }
@@ -97,6 +121,7 @@ public class AudioEngine {
     }
 
     public void release() {
+        stopPosePolling();
         mSourceIds.clear();
         mEngines.remove(mContext);
         for (Sound sound: Sound.values()) {
@@ -108,11 +133,44 @@ public class AudioEngine {
     }
 
     public void pauseEngine() {
+        stopPosePolling();
         mEngine.pause();
     }
 
     public void resumeEngine() {
         mEngine.resume();
+        startPosePolling();
+    }
+
+    // aSource is polled on the main thread while the engine is resumed. May be called
+    // from any thread.
+    public void setPoseSource(PoseSource aSource) {
+        mPoseSource = aSource;
+    }
+
+    private void startPosePolling() {
+        if (!mPosePolling) {
+            mPosePolling = true;
+            mPoseHandler.post(mPoseRunnable);
+        }
+    }
+
+    private void stopPosePolling() {
+        mPosePolling = false;
+        mPoseHandler.removeCallbacks(mPoseRunnable);
+    }
+
+    private void updatePose() {
+        PoseSource source = mPoseSource;
+        if (source == null) {
+            return;
+        }
+        int sequence = source.readPose(mPose);
+        if ((sequence < 0) || (sequence == mPoseSequence)) {
+            return;
+        }
+        mPoseSequence = sequence;
+        setPose(mPose[0], mPose[1], mPose[2], mPose[3], mPose[4], mPose[5], mPose[6]);
     }
 
     public void setPose(float qx, float qy, float qz, float qw, float px, float py, float pz) {
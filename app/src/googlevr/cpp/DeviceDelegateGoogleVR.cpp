@@ -6,6 +6,8 @@
 #include "DeviceDelegateGoogleVR.h"
 #include "ElbowModel.h"
 #include "GestureDelegate.h"
+#include "GLStateCache.h"
+#include "Trace.h"
 
 #include "vrb/CameraEye.h"
 #include "vrb/Color.h"
@@ -73,6 +75,7 @@ struct DeviceDelegateGoogleVR::State {
   vrb::ContextWeak context;
   float near;
   float far;
+  float renderScale;
   bool sixDofHead;
   vrb::Color clearColor;
   vrb::CameraEyePtr cameras[2];
@@ -92,6 +95,7 @@ struct DeviceDelegateGoogleVR::State {
       , frame(nullptr)
       , near(0.1f)
       , far(100.f)
+      , renderScale(1.0f)
       , sixDofHead(false)
   {
     frameBufferSize = {0,0};
@@ -165,6 +169,19 @@ struct DeviceDelegateGoogleVR::State {
     }
   }
 
+  // Both eyes share one buffer, so scaling each source rectangle towards the
+  // origin keeps them side by side in the lower left of the buffer.
+  void
+  ScaleSourceUV(const size_t aIndex, gvr_buffer_viewport* aViewport) {
+    gvr_rectf uv = GVR_CHECK(gvr_buffer_viewport_get_source_uv(aViewport));
+    uv.left *= renderScale;
+    uv.right *= renderScale;
+    uv.bottom *= renderScale;
+    uv.top *= renderScale;
+    GVR_CHECK(gvr_buffer_viewport_set_source_uv(aViewport, uv));
+    GVR_CHECK(gvr_buffer_viewport_list_set_item(viewportList, aIndex, aViewport));
+  }
+
   void
   UpdateCameras() {
     for (uint32_t eyeIndex = 0; eyeIndex < 2; eyeIndex++) {
@@ -179,6 +196,10 @@ struct DeviceDelegateGoogleVR::State {
     GVR_CHECK(gvr_get_recommended_buffer_viewports(gvr, viewportList));
     GVR_CHECK(gvr_buffer_viewport_list_get_item(viewportList, 0, leftViewport));
     GVR_CHECK(gvr_buffer_viewport_list_get_item(viewportList, 1, rightViewport));
+    if (renderScale < 1.0f) {
+      ScaleSourceUV(0, leftViewport);
+      ScaleSourceUV(1, rightViewport);
+    }
 
     gvr_rectf fov = GVR_CHECK(gvr_buffer_viewport_get_source_fov(leftViewport));
     cameras[cameraIndex(CameraEnum::Left)]->SetPerspective(
@@ -348,6 +369,22 @@ DeviceDelegateGoogleVR::GetControllerModelName(const int32_t aModelIndex) const
   return aModelIndex == 0 ? name : "";
 }
 
+float
+DeviceDelegateGoogleVR::GetDisplayPeriod() const {
+  // Daydream does not report its refresh rate; all supported phones run at 60Hz.
+  return 1.0f / 60.0f;
+}
+
+int64_t
+DeviceDelegateGoogleVR::GetPredictedDisplayTime() const {
+  return 0;
+}
+
+bool
+DeviceDelegateGoogleVR::GetHiddenAreaMesh(const CameraEnum aWhich, std::vector<float>& aVertices) const {
+  return false;
+}
+
 void
 DeviceDelegateGoogleVR::ProcessEvents() {
   static const vrb::Vector kAverageHeight(0.0f, 1.7f, 0.0f);
@@ -367,6 +404,7 @@ DeviceDelegateGoogleVR::ProcessEvents() {
 
 void
 DeviceDelegateGoogleVR::StartFrame() {
+  CROW_TRACE_SCOPE("DeviceDelegateGoogleVR::StartFrame");
 
   m.frame = GVR_CHECK(gvr_swap_chain_acquire_frame(m.swapChain));
   if (!m.frame) {
@@ -383,8 +421,8 @@ DeviceDelegateGoogleVR::StartFrame() {
   }
 
   GVR_CHECK(gvr_frame_bind_buffer(m.frame, 0));
-  VRB_GL_CHECK(glClearColor(m.clearColor.Red(), m.clearColor.Green(), m.clearColor.Blue(), m.clearColor.Alpha()));
-  VRB_GL_CHECK(glEnable(GL_BLEND));
+  GLStateCache::ClearColor(m.clearColor.Red(), m.clearColor.Green(), m.clearColor.Blue(), m.clearColor.Alpha());
+  GLStateCache::Enable(GL_BLEND);
 }
 
 static void
@@ -395,9 +433,9 @@ SetUpViewportAndScissor(const gvr_sizei& framebuf_size,
   int bottom = static_cast<int>(rect.bottom * framebuf_size.width);
   int width = static_cast<int>((rect.right - rect.left) * framebuf_size.width);
   int height = static_cast<int>((rect.top - rect.bottom) * framebuf_size.height);
-  VRB_GL_CHECK(glViewport(left, bottom, width, height));
-  VRB_GL_CHECK(glEnable(GL_SCISSOR_TEST));
-  VRB_GL_CHECK(glScissor(left, bottom, width, height));
+  GLStateCache::Viewport(left, bottom, width, height);
+  GLStateCache::Enable(GL_SCISSOR_TEST);
+  GLStateCache::Scissor(left, bottom, width, height);
   VRB_GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 }
 
@@ -413,13 +451,22 @@ DeviceDelegateGoogleVR::BindEye(const CameraEnum aWhich) {
 
 }
 
+bool
+DeviceDelegateGoogleVR::SetRenderScale(const float aScale) {
+  m.renderScale = aScale;
+  return true;
+}
+
 void
 DeviceDelegateGoogleVR::EndFrame() {
+  CROW_TRACE_SCOPE("DeviceDelegateGoogleVR::EndFrame");
   if (!m.frame) {
     VRB_LOG("Unable to submit null frame");
   }
   GVR_CHECK(gvr_frame_unbind(m.frame));
   GVR_CHECK(gvr_frame_submit(&m.frame, m.viewportList, m.gvrHeadMatrix));
+  // GVR distorts the frame on our context.
+  GLStateCache::Invalidate();
 }
 
 
@@ -428,8 +475,8 @@ DeviceDelegateGoogleVR::InitializeGL() {
   gvr_initialize_gl(m.gvr);
   m.CreateSwapChain();
   m.InitializeControllers();
-  VRB_GL_CHECK(glEnable(GL_DEPTH_TEST));
-  VRB_GL_CHECK(glEnable(GL_CULL_FACE));
+  GLStateCache::Enable(GL_DEPTH_TEST);
+  GLStateCache::Enable(GL_CULL_FACE);
   m.sixDofHead = GVR_CHECK(gvr_is_feature_supported(m.gvr, GVR_FEATURE_HEAD_POSE_6DOF));
   VRB_LOG("6DoF head tracking supported: %s", (m.sixDofHead ? "True" : "False"));
 }
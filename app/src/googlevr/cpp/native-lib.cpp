@@ -9,6 +9,7 @@
 
 #include "BrowserWorld.h"
 #include "DeviceDelegateGoogleVR.h"
+#include "GLStateCache.h"
 #include "vrb/GLError.h"
 
 static crow::BrowserWorldPtr sWorld;
@@ -41,6 +42,8 @@ JNI_METHOD(void, activityResumed)
 
 JNI_METHOD(void, activityCreated)
 (JNIEnv* aEnv, jobject aActivity, jobject aAssetManager, int64_t aGVRContext) {
+  // Called from onSurfaceCreated, with a new GL context current.
+  crow::GLStateCache::Invalidate();
   if (!sDevice) {
     sDevice = crow::DeviceDelegateGoogleVR::Create(sWorld->GetWeakContext(), (void*) aGVRContext);
   }
@@ -0,0 +1,362 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "DeviceDelegateHeadless.h"
+#include "ElbowModel.h"
+#include "EyeBufferHints.h"
+#include "GLStateCache.h"
+#include "Trace.h"
+
+#include "vrb/CameraEye.h"
+#include "vrb/Color.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/FBO.h"
+#include "vrb/GLError.h"
+#include "vrb/Matrix.h"
+#include "vrb/Vector.h"
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace crow {
+
+static const int32_t kMaxControllerCount = 4;
+static const int32_t kEyeCount = 2;
+// Simulated display refresh rate used to advance the pose script.
+static const float kFramePeriod = 1.0f / 72.0f;
+static const float kFieldOfView = 50.0f;
+static const vrb::Vector kAverageHeight(0.0f, 1.7f, 0.0f);
+static const vrb::Vector kUp(0.0f, 1.0f, 0.0f);
+static const vrb::Vector kRight(1.0f, 0.0f, 0.0f);
+
+struct HeadlessEye {
+  GLuint texture;
+  vrb::FBOPtr fbo;
+  HeadlessEye() : texture(0) {}
+};
+
+struct DeviceDelegateHeadless::State {
+  vrb::ContextWeak context;
+  ControllerDelegatePtr controller;
+  vrb::CameraEyePtr cameras[kEyeCount];
+  HeadlessEye eyes[kEyeCount];
+  vrb::FBOPtr currentFBO;
+  vrb::Color clearColor;
+  vrb::Matrix head;
+  ElbowModelPtr elbow;
+  InputReplayerPtr replay;
+  int32_t controllerCount;
+  int32_t renderWidth;
+  int32_t renderHeight;
+  float renderScale;
+  float near;
+  float far;
+  uint32_t frameIndex;
+  State()
+      : head(vrb::Matrix::Identity())
+      , controllerCount(1)
+      , renderWidth(1024)
+      , renderHeight(1024)
+      , renderScale(1.0f)
+      , near(0.1f)
+      , far(100.0f)
+      , frameIndex(0)
+  {}
+
+  int32_t cameraIndex(CameraEnum aWhich) {
+    if (CameraEnum::Left == aWhich) { return 0; }
+    else if (CameraEnum::Right == aWhich) { return 1; }
+    return -1;
+  }
+
+  void Initialize() {
+    const float ipd = 0.064f;
+    for (int32_t index = 0; index < kEyeCount; index++) {
+      cameras[index] = vrb::CameraEye::Create(context);
+    }
+    cameras[cameraIndex(CameraEnum::Left)]->SetEyeTransform(vrb::Matrix::Translation(vrb::Vector(-ipd * 0.5f, 0.0f, 0.0f)));
+    cameras[cameraIndex(CameraEnum::Right)]->SetEyeTransform(vrb::Matrix::Translation(vrb::Vector(ipd * 0.5f, 0.0f, 0.0f)));
+    UpdatePerspective();
+    elbow = ElbowModel::Create();
+  }
+
+  void UpdatePerspective() {
+    const vrb::Matrix perspective = vrb::Matrix::PerspectiveMatrixFromDegrees(
+        kFieldOfView, kFieldOfView, kFieldOfView, kFieldOfView, near, far);
+    for (int32_t index = 0; index < kEyeCount; index++) {
+      cameras[index]->SetPerspective(perspective);
+    }
+  }
+
+  void Shutdown() {
+  }
+
+  // The script sweeps the head slowly from side to side and moves each
+  // controller across the widgets in front of the user, pressing the trigger
+  // and touching the touchpad at fixed frame intervals.
+  void UpdateHead(const float aTime) {
+    const float yaw = 0.5f * sinf(aTime * 0.7f);
+    const float pitch = 0.1f * sinf(aTime * 1.3f);
+    head = vrb::Matrix::Rotation(kUp, yaw).PostMultiply(vrb::Matrix::Rotation(kRight, pitch));
+    head.TranslateInPlace(kAverageHeight);
+    UpdateCameras();
+  }
+
+  void UpdateCameras() {
+    for (int32_t index = 0; index < kEyeCount; index++) {
+      cameras[index]->SetHeadTransform(head);
+    }
+  }
+
+  void UpdateControllers(const float aTime) {
+    if (!controller) {
+      return;
+    }
+    for (int32_t index = 0; index < controllerCount; index++) {
+      const float phase = (float)index;
+      const float yaw = 0.35f * sinf(aTime * (1.1f + 0.3f * phase) + phase);
+      const float pitch = 0.15f + 0.2f * sinf(aTime * 0.9f + phase);
+      vrb::Matrix transform = vrb::Matrix::Rotation(kUp, yaw).PostMultiply(vrb::Matrix::Rotation(kRight, pitch));
+      const ElbowModel::HandEnum hand = (index % 2) == 0 ? ElbowModel::HandEnum::Right : ElbowModel::HandEnum::Left;
+      transform = elbow->GetTransform(hand, head, transform);
+      controller->SetTransform(index, transform);
+
+      const uint32_t step = frameIndex + (uint32_t)index * 17;
+      controller->SetButtonState(index, ControllerDelegate::BUTTON_TRIGGER, (step % 120) < 8);
+      if (((step / 60) % 3) == 0) {
+        controller->SetTouchPosition(index, 0.5f * sinf(aTime), 0.5f * cosf(aTime));
+      } else {
+        controller->EndTouch(index);
+      }
+    }
+  }
+};
+
+DeviceDelegateHeadlessPtr
+DeviceDelegateHeadless::Create(vrb::ContextWeak aContext) {
+  DeviceDelegateHeadlessPtr result = std::make_shared<vrb::ConcreteClass<DeviceDelegateHeadless, DeviceDelegateHeadless::State> >();
+  result->m.context = aContext;
+  result->m.Initialize();
+  return result;
+}
+
+GestureDelegateConstPtr
+DeviceDelegateHeadless::GetGestureDelegate() {
+  return nullptr;
+}
+
+vrb::CameraPtr
+DeviceDelegateHeadless::GetCamera(const CameraEnum aWhich) {
+  const int32_t index = m.cameraIndex(aWhich);
+  if (index < 0) { return nullptr; }
+  return m.cameras[index];
+}
+
+const vrb::Matrix&
+DeviceDelegateHeadless::GetHeadTransform() const {
+  return m.cameras[0]->GetHeadTransform();
+}
+
+void
+DeviceDelegateHeadless::SetClearColor(const vrb::Color& aColor) {
+  m.clearColor = aColor;
+}
+
+void
+DeviceDelegateHeadless::SetClipPlanes(const float aNear, const float aFar) {
+  m.near = aNear;
+  m.far = aFar;
+  m.UpdatePerspective();
+}
+
+void
+DeviceDelegateHeadless::SetControllerDelegate(ControllerDelegatePtr& aController) {
+  m.controller = aController;
+  if (!m.controller) {
+    return;
+  }
+  for (int32_t index = 0; index < m.controllerCount; index++) {
+    m.controller->CreateController(index, 0);
+    m.controller->SetEnabled(index, true);
+    m.controller->SetVisible(index, true);
+  }
+}
+
+void
+DeviceDelegateHeadless::ReleaseControllerDelegate() {
+  m.controller = nullptr;
+}
+
+int32_t
+DeviceDelegateHeadless::GetControllerModelCount() const {
+  return 1;
+}
+
+const std::string
+DeviceDelegateHeadless::GetControllerModelName(const int32_t aModelIndex) const {
+  static const std::string name("vr_controller_daydream.obj");
+  return aModelIndex == 0 ? name : "";
+}
+
+float
+DeviceDelegateHeadless::GetDisplayPeriod() const {
+  return kFramePeriod;
+}
+
+int64_t
+DeviceDelegateHeadless::GetPredictedDisplayTime() const {
+  return 0;
+}
+
+bool
+DeviceDelegateHeadless::GetHiddenAreaMesh(const CameraEnum aWhich, std::vector<float>& aVertices) const {
+  return false;
+}
+
+void
+DeviceDelegateHeadless::ProcessEvents() {
+  if (m.replay) {
+    // Once the recording runs out the last recorded pose is held.
+    if (m.controller && m.replay->PlayFrame(*m.controller, m.head)) {
+      m.UpdateCameras();
+    }
+    return;
+  }
+  const float time = (float)m.frameIndex * kFramePeriod;
+  m.UpdateHead(time);
+  m.UpdateControllers(time);
+}
+
+void
+DeviceDelegateHeadless::StartFrame() {
+  CROW_TRACE_SCOPE("DeviceDelegateHeadless::StartFrame");
+  m.frameIndex++;
+  GLStateCache::ClearColor(m.clearColor.Red(), m.clearColor.Green(), m.clearColor.Blue(), m.clearColor.Alpha());
+}
+
+void
+DeviceDelegateHeadless::BindEye(const CameraEnum aWhich) {
+  const int32_t index = m.cameraIndex(aWhich);
+  if (index < 0) {
+    VRB_LOG("No eye found");
+    return;
+  }
+  if (m.currentFBO) {
+    EyeBufferHints::EndPass(m.renderWidth, m.renderHeight, 1);
+    m.currentFBO->Unbind();
+  }
+  m.currentFBO = m.eyes[index].fbo;
+  if (m.currentFBO) {
+    m.currentFBO->Bind();
+    GLStateCache::Viewport(0, 0, (GLsizei)(m.renderWidth * m.renderScale),
+                           (GLsizei)(m.renderHeight * m.renderScale));
+    EyeBufferHints::BeginPass();
+  } else {
+    VRB_LOG("No eye FBO found");
+  }
+}
+
+bool
+DeviceDelegateHeadless::SetRenderScale(const float aScale) {
+  m.renderScale = aScale;
+  return true;
+}
+
+void
+DeviceDelegateHeadless::EndFrame() {
+  CROW_TRACE_SCOPE("DeviceDelegateHeadless::EndFrame");
+  if (m.currentFBO) {
+    EyeBufferHints::EndPass(m.renderWidth, m.renderHeight, 1);
+    m.currentFBO->Unbind();
+    m.currentFBO = nullptr;
+  }
+}
+
+void
+DeviceDelegateHeadless::SetControllerCount(const int32_t aCount) {
+  m.controllerCount = aCount;
+  if (m.controllerCount < 0) {
+    m.controllerCount = 0;
+  } else if (m.controllerCount > kMaxControllerCount) {
+    m.controllerCount = kMaxControllerCount;
+  }
+}
+
+void
+DeviceDelegateHeadless::SetRenderSize(const int32_t aWidth, const int32_t aHeight) {
+  m.renderWidth = aWidth;
+  m.renderHeight = aHeight;
+}
+
+void
+DeviceDelegateHeadless::SetReplay(const InputReplayerPtr& aReplay) {
+  m.replay = aReplay;
+}
+
+void
+DeviceDelegateHeadless::InitializeGL() {
+  ShutdownGL();
+  for (HeadlessEye& eye: m.eyes) {
+    VRB_GL_CHECK(glGenTextures(1, &eye.texture));
+    VRB_GL_CHECK(glBindTexture(GL_TEXTURE_2D, eye.texture));
+    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    VRB_GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m.renderWidth, m.renderHeight, 0,
+                              GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    eye.fbo = vrb::FBO::Create(m.context);
+    vrb::FBO::Attributes attributes;
+    VRB_GL_CHECK(eye.fbo->SetTextureHandle(eye.texture, m.renderWidth, m.renderHeight, attributes));
+    if (!eye.fbo->IsValid()) {
+      VRB_LOG("FAILED to make valid FBO");
+      eye.fbo = nullptr;
+    }
+  }
+  GLStateCache::Invalidate();
+  GLStateCache::Enable(GL_DEPTH_TEST);
+  GLStateCache::Enable(GL_CULL_FACE);
+}
+
+void
+DeviceDelegateHeadless::ShutdownGL() {
+  m.currentFBO = nullptr;
+  for (HeadlessEye& eye: m.eyes) {
+    eye.fbo = nullptr;
+    if (eye.texture) {
+      VRB_GL_CHECK(glDeleteTextures(1, &eye.texture));
+      eye.texture = 0;
+    }
+  }
+}
+
+uint32_t
+DeviceDelegateHeadless::GetFrameIndex() const {
+  return m.frameIndex;
+}
+
+void
+DeviceDelegateHeadless::SetFrameIndex(const uint32_t aIndex) {
+  m.frameIndex = aIndex;
+}
+
+bool
+DeviceDelegateHeadless::ReadEye(const CameraEnum aWhich, std::vector<uint8_t>& aPixels) {
+  const int32_t index = m.cameraIndex(aWhich);
+  if ((index < 0) || !m.eyes[index].fbo) {
+    return false;
+  }
+  aPixels.resize((size_t)(m.renderWidth * m.renderHeight * 4));
+  m.eyes[index].fbo->Bind();
+  VRB_GL_CHECK(glReadPixels(0, 0, m.renderWidth, m.renderHeight, GL_RGBA, GL_UNSIGNED_BYTE, aPixels.data()));
+  m.eyes[index].fbo->Unbind();
+  return true;
+}
+
+DeviceDelegateHeadless::DeviceDelegateHeadless(State& aState) : m(aState) {}
+DeviceDelegateHeadless::~DeviceDelegateHeadless() { m.Shutdown(); }
+
+} // namespace crow
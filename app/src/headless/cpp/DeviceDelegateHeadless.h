@@ -0,0 +1,67 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef DEVICE_DELEGATE_HEADLESS_DOT_H
+#define DEVICE_DELEGATE_HEADLESS_DOT_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+#include "DeviceDelegate.h"
+#include "InputReplayer.h"
+#include <memory>
+#include <vector>
+
+namespace crow {
+
+class DeviceDelegateHeadless;
+typedef std::shared_ptr<DeviceDelegateHeadless> DeviceDelegateHeadlessPtr;
+
+// Device delegate used by the Linux host build. Head and controller poses are
+// generated from a deterministic script so that frame costs are repeatable
+// between runs, or replayed from an input recording. Eyes are rendered into
+// offscreen FBOs.
+class DeviceDelegateHeadless : public DeviceDelegate {
+public:
+  static DeviceDelegateHeadlessPtr Create(vrb::ContextWeak aContext);
+  // DeviceDelegate interface
+  GestureDelegateConstPtr GetGestureDelegate() override;
+  vrb::CameraPtr GetCamera(const CameraEnum aWhich) override;
+  const vrb::Matrix& GetHeadTransform() const override;
+  void SetClearColor(const vrb::Color& aColor) override;
+  void SetClipPlanes(const float aNear, const float aFar) override;
+  void SetControllerDelegate(ControllerDelegatePtr& aController) override;
+  void ReleaseControllerDelegate() override;
+  int32_t GetControllerModelCount() const override;
+  const std::string GetControllerModelName(const int32_t aModelIndex) const override;
+  float GetDisplayPeriod() const override;
+  int64_t GetPredictedDisplayTime() const override;
+  bool GetHiddenAreaMesh(const CameraEnum aWhich, std::vector<float>& aVertices) const override;
+  void ProcessEvents() override;
+  void StartFrame() override;
+  void BindEye(const CameraEnum aWhich) override;
+  bool SetRenderScale(const float aScale) override;
+  void EndFrame() override;
+  // DeviceDelegateHeadless interface
+  void SetControllerCount(const int32_t aCount);
+  void SetRenderSize(const int32_t aWidth, const int32_t aHeight);
+  void SetReplay(const InputReplayerPtr& aReplay);
+  void InitializeGL();
+  void ShutdownGL();
+  uint32_t GetFrameIndex() const;
+  // Rewinds the pose script so a frame can be rendered again.
+  void SetFrameIndex(const uint32_t aIndex);
+  // Reads back the last frame drawn to an eye as RGBA rows, bottom row first.
+  bool ReadEye(const CameraEnum aWhich, std::vector<uint8_t>& aPixels);
+protected:
+  struct State;
+  DeviceDelegateHeadless(State& aState);
+  virtual ~DeviceDelegateHeadless();
+private:
+  State& m;
+  VRB_NO_DEFAULTS(DeviceDelegateHeadless)
+};
+
+} // namespace crow
+#endif // DEVICE_DELEGATE_HEADLESS_DOT_H
@@ -0,0 +1,112 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "HeadlessEGLContext.h"
+#include "vrb/Logger.h"
+#include <EGL/eglext.h>
+#include <cstring>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+namespace crow {
+
+HeadlessEGLContext::HeadlessEGLContext()
+  : mMajorVersion(0), mMinorVersion(0), mDisplay(EGL_NO_DISPLAY), mConfig(0),
+    mSurface(EGL_NO_SURFACE), mContext(EGL_NO_CONTEXT) {
+}
+
+HeadlessEGLContextPtr
+HeadlessEGLContext::Create() {
+  return std::make_shared<HeadlessEGLContext>();
+}
+
+bool
+HeadlessEGLContext::Initialize() {
+  const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  if (extensions && strstr(extensions, "EGL_MESA_platform_surfaceless")) {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+      mDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+  }
+  if (mDisplay == EGL_NO_DISPLAY) {
+    mDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+  if (eglInitialize(mDisplay, &mMajorVersion, &mMinorVersion) == EGL_FALSE) {
+    VRB_LOG("eglInitialize() failed: 0x%x", eglGetError());
+    return false;
+  }
+
+  const EGLint configAttribs[] = {
+          EGL_RED_SIZE, 8,
+          EGL_GREEN_SIZE, 8,
+          EGL_BLUE_SIZE, 8,
+          EGL_ALPHA_SIZE, 8,
+          EGL_DEPTH_SIZE, 24,
+          EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+          EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT_KHR,
+          EGL_NONE
+  };
+  EGLint numConfigs = 0;
+  if ((eglChooseConfig(mDisplay, configAttribs, &mConfig, 1, &numConfigs) == EGL_FALSE) || (numConfigs < 1)) {
+    VRB_LOG("eglChooseConfig() failed: 0x%x", eglGetError());
+    return false;
+  }
+
+  const EGLint surfaceAttribs[] = {
+          EGL_WIDTH, 1,
+          EGL_HEIGHT, 1,
+          EGL_NONE
+  };
+  mSurface = eglCreatePbufferSurface(mDisplay, mConfig, surfaceAttribs);
+  if (mSurface == EGL_NO_SURFACE) {
+    VRB_LOG("eglCreatePbufferSurface() failed: 0x%x", eglGetError());
+    return false;
+  }
+
+  eglBindAPI(EGL_OPENGL_ES_API);
+  const EGLint contextAttribs[] = {
+          EGL_CONTEXT_CLIENT_VERSION, 3,
+          EGL_NONE
+  };
+  mContext = eglCreateContext(mDisplay, mConfig, EGL_NO_CONTEXT, contextAttribs);
+  if (mContext == EGL_NO_CONTEXT) {
+    VRB_LOG("eglCreateContext() failed: 0x%x", eglGetError());
+    return false;
+  }
+  VRB_LOG("Headless EGL %d.%d initialized", mMajorVersion, mMinorVersion);
+  return true;
+}
+
+void
+HeadlessEGLContext::Destroy() {
+  if (mDisplay != EGL_NO_DISPLAY) {
+    eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (mContext != EGL_NO_CONTEXT) {
+      eglDestroyContext(mDisplay, mContext);
+    }
+    if (mSurface != EGL_NO_SURFACE) {
+      eglDestroySurface(mDisplay, mSurface);
+    }
+    eglTerminate(mDisplay);
+  }
+  mDisplay = EGL_NO_DISPLAY;
+  mContext = EGL_NO_CONTEXT;
+  mSurface = EGL_NO_SURFACE;
+}
+
+bool
+HeadlessEGLContext::MakeCurrent() {
+  if (eglMakeCurrent(mDisplay, mSurface, mSurface, mContext) == EGL_FALSE) {
+    VRB_LOG("eglMakeCurrent() failed: 0x%x", eglGetError());
+    return false;
+  }
+  return true;
+}
+
+} // namespace crow
@@ -0,0 +1,186 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Replays a per-frame timing trace through ClockGovernor and reports the
+// levels it picked, how often it changed them and how many frames would have
+// missed vsync. Frame times are rescaled by a simple model of clock level
+// against speed, so lowering a level makes later frames slower. Without an
+// input file a synthetic idle, heavy, idle trace is used.
+//
+// Input: one frame per line, "cpu_ms gpu_ms", with a negative gpu_ms if the
+// GPU time is unknown. Lines starting with # are ignored.
+
+#include "ClockGovernor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace crow;
+
+namespace {
+
+// Relative speed gained per clock level.
+const double kLevelSpeedup = 0.2;
+const int32_t kMaxLevels = 16;
+
+struct Options {
+  std::string inputPath;
+  double period = 1000.0 / 72.0; // Milliseconds.
+  int32_t minLevel = 0;
+  int32_t maxLevel = 4;
+  int32_t recordedLevel = -1; // Defaults to maxLevel.
+  int32_t startLevel = -1; // Defaults to maxLevel.
+};
+
+struct Frame {
+  double cpu; // Milliseconds.
+  double gpu;
+};
+
+bool
+ParseOptions(int aArgc, char* aArgv[], Options& aOptions) {
+  for (int index = 1; index < aArgc; index++) {
+    const char* arg = aArgv[index];
+    const char* value = (index + 1) < aArgc ? aArgv[index + 1] : nullptr;
+    if (!value) {
+      return false;
+    }
+    if (strcmp(arg, "--input") == 0) {
+      aOptions.inputPath = value;
+    } else if (strcmp(arg, "--period") == 0) {
+      aOptions.period = atof(value);
+    } else if (strcmp(arg, "--levels") == 0) {
+      if (sscanf(value, "%d-%d", &aOptions.minLevel, &aOptions.maxLevel) != 2) {
+        return false;
+      }
+    } else if (strcmp(arg, "--recorded-level") == 0) {
+      aOptions.recordedLevel = atoi(value);
+    } else if (strcmp(arg, "--start-level") == 0) {
+      aOptions.startLevel = atoi(value);
+    } else {
+      return false;
+    }
+    index++;
+  }
+  if (aOptions.recordedLevel < 0) {
+    aOptions.recordedLevel = aOptions.maxLevel;
+  }
+  if (aOptions.startLevel < 0) {
+    aOptions.startLevel = aOptions.maxLevel;
+  }
+  return (aOptions.period > 0.0) && (aOptions.minLevel >= 0) &&
+         (aOptions.minLevel <= aOptions.maxLevel) && (aOptions.maxLevel < kMaxLevels);
+}
+
+bool
+LoadTrace(const std::string& aPath, std::vector<Frame>& aFrames) {
+  FILE* file = fopen(aPath.c_str(), "r");
+  if (!file) {
+    fprintf(stderr, "Unable to open %s\n", aPath.c_str());
+    return false;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), file)) {
+    Frame frame;
+    if ((line[0] != '#') && (sscanf(line, "%lf %lf", &frame.cpu, &frame.gpu) == 2)) {
+      aFrames.push_back(frame);
+    }
+  }
+  fclose(file);
+  return !aFrames.empty();
+}
+
+void
+AddPhase(const int32_t aCount, const double aCPU, const double aGPU, std::vector<Frame>& aFrames) {
+  for (int32_t index = 0; index < aCount; index++) {
+    // Small deterministic jitter so thresholds are not crossed in lockstep.
+    const double jitter = 1.0 + 0.1 * std::sin((double)(aFrames.size()) * 0.37);
+    aFrames.push_back({aCPU * jitter, aGPU * jitter});
+  }
+}
+
+double
+Speed(const int32_t aLevel) {
+  return 1.0 + kLevelSpeedup * (double)aLevel;
+}
+
+} // namespace
+
+int
+main(int aArgc, char* aArgv[]) {
+  Options options;
+  if (!ParseOptions(aArgc, aArgv, options)) {
+    fprintf(stderr, "Usage: %s [--input FILE] [--period MS] [--levels MIN-MAX] [--recorded-level N]\n"
+            "       [--start-level N]\n",
+            aArgv[0]);
+    return 1;
+  }
+  std::vector<Frame> frames;
+  if (!options.inputPath.empty()) {
+    if (!LoadTrace(options.inputPath, frames)) {
+      return 1;
+    }
+  } else {
+    AddPhase(3000, 4.0, 5.0, frames);
+    AddPhase(3000, 9.0, 12.0, frames);
+    AddPhase(3000, 4.0, 5.0, frames);
+  }
+
+  ClockGovernorPtr governor = ClockGovernor::Create();
+  governor->SetRange(options.minLevel, options.maxLevel, options.startLevel);
+  const float period = (float)(options.period / 1000.0);
+  const double recordedSpeed = Speed(options.recordedLevel);
+  int64_t cpuFrames[kMaxLevels] = {};
+  int64_t gpuFrames[kMaxLevels] = {};
+  int32_t changes = 0;
+  int32_t missed = 0;
+  int32_t recordedMissed = 0;
+  for (const Frame& frame: frames) {
+    const int32_t cpuLevel = governor->GetCPULevel();
+    const int32_t gpuLevel = governor->GetGPULevel();
+    cpuFrames[cpuLevel]++;
+    gpuFrames[gpuLevel]++;
+    const double cpu = frame.cpu * recordedSpeed / Speed(cpuLevel);
+    const double gpu = frame.gpu >= 0.0 ? frame.gpu * recordedSpeed / Speed(gpuLevel) : -1.0;
+    // Vsync-locked: a frame takes as many periods as its slowest unit needs.
+    const double busiest = std::max(cpu, gpu);
+    const double interval = std::max(1.0, std::ceil(busiest / options.period)) * options.period;
+    if (interval > options.period) {
+      missed++;
+    }
+    if (std::max(frame.cpu, frame.gpu) > options.period) {
+      recordedMissed++;
+    }
+    ClockGovernor::Sample sample;
+    sample.cpuTime = (int64_t)(cpu * 1.0e6);
+    sample.gpuTime = gpu >= 0.0 ? (int64_t)(gpu * 1.0e6) : -1;
+    sample.frameInterval = (int64_t)(interval * 1.0e6);
+    if (governor->Update(sample, period)) {
+      changes++;
+    }
+  }
+
+  const double count = (double)frames.size();
+  double cpuMean = 0.0;
+  double gpuMean = 0.0;
+  printf("frames: %d period: %.2f ms levels: %d-%d\n", (int)frames.size(), options.period,
+         options.minLevel, options.maxLevel);
+  printf("%6s %10s %10s\n", "level", "cpu", "gpu");
+  for (int32_t level = options.minLevel; level <= options.maxLevel; level++) {
+    printf("%6d %9.1f%% %9.1f%%\n", level, 100.0 * (double)cpuFrames[level] / count,
+           100.0 * (double)gpuFrames[level] / count);
+    cpuMean += (double)(level * cpuFrames[level]) / count;
+    gpuMean += (double)(level * gpuFrames[level]) / count;
+  }
+  printf("mean level: cpu %.2f gpu %.2f\n", cpuMean, gpuMean);
+  printf("level changes: %d\n", changes);
+  printf("missed frames: %d (%d at the recorded level)\n", missed, recordedMissed);
+  return 0;
+}
@@ -0,0 +1,206 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "BrowserWorld.h"
+#include "DeviceDelegateHeadless.h"
+#include "EyeBufferHints.h"
+#include "FrameTimings.h"
+#include "GLStateCache.h"
+#include "HeadlessEGLContext.h"
+#include "InputReplayer.h"
+#include "Trace.h"
+#include "vrb/GLError.h"
+#include "vrb/Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace crow;
+
+namespace {
+
+struct Options {
+  int32_t frames = 1000;
+  int32_t warmup = 60;
+  int32_t controllers = 1;
+  int32_t width = 1024;
+  int32_t height = 1024;
+  float lensRadius = 0.0f;
+  float minScale = 1.0f;
+  std::string tracePath;
+  std::string recordPath;
+  std::string replayPath;
+};
+
+void
+PrintUsage(const char* aName) {
+  fprintf(stderr, "Usage: %s [--frames N] [--warmup N] [--controllers 1-4] [--size WIDTHxHEIGHT] [--trace FILE]\n"
+          "       [--lens-radius R] [--min-scale S] [--record FILE | --replay FILE]\n", aName);
+}
+
+bool
+ParseOptions(int aArgc, char* aArgv[], Options& aOptions) {
+  for (int index = 1; index < aArgc; index++) {
+    const char* arg = aArgv[index];
+    const char* value = (index + 1) < aArgc ? aArgv[index + 1] : nullptr;
+    if (!value) {
+      return false;
+    }
+    if (strcmp(arg, "--frames") == 0) {
+      aOptions.frames = atoi(value);
+    } else if (strcmp(arg, "--warmup") == 0) {
+      aOptions.warmup = atoi(value);
+    } else if (strcmp(arg, "--controllers") == 0) {
+      aOptions.controllers = atoi(value);
+    } else if (strcmp(arg, "--size") == 0) {
+      if (sscanf(value, "%dx%d", &aOptions.width, &aOptions.height) != 2) {
+        return false;
+      }
+    } else if (strcmp(arg, "--lens-radius") == 0) {
+      aOptions.lensRadius = (float)atof(value);
+    } else if (strcmp(arg, "--min-scale") == 0) {
+      aOptions.minScale = (float)atof(value);
+    } else if (strcmp(arg, "--trace") == 0) {
+      aOptions.tracePath = value;
+    } else if (strcmp(arg, "--record") == 0) {
+      aOptions.recordPath = value;
+    } else if (strcmp(arg, "--replay") == 0) {
+      aOptions.replayPath = value;
+    } else {
+      return false;
+    }
+    index++;
+  }
+  return (aOptions.frames > 0) && (aOptions.recordPath.empty() || aOptions.replayPath.empty());
+}
+
+double
+Percentile(const std::vector<double>& aSorted, const double aPercent) {
+  if (aSorted.empty()) {
+    return 0.0;
+  }
+  size_t index = (size_t)(aPercent * (double)(aSorted.size() - 1) + 0.5);
+  return aSorted[std::min(index, aSorted.size() - 1)];
+}
+
+} // namespace
+
+int
+main(int aArgc, char* aArgv[]) {
+  Options options;
+  if (!ParseOptions(aArgc, aArgv, options)) {
+    PrintUsage(aArgv[0]);
+    return 1;
+  }
+
+  HeadlessEGLContextPtr egl = HeadlessEGLContext::Create();
+  if (!egl->Initialize() || !egl->MakeCurrent()) {
+    VRB_LOG("Unable to create headless GL context");
+    return 1;
+  }
+
+  BrowserWorldPtr world = BrowserWorld::Create();
+  DeviceDelegateHeadlessPtr device = DeviceDelegateHeadless::Create(world->GetWeakContext());
+  if (!options.replayPath.empty()) {
+    InputReplayerPtr replay = InputReplayer::Create();
+    if (!replay->Open(options.replayPath)) {
+      return 1;
+    }
+    // The recording creates its own controllers.
+    options.controllers = 0;
+    device->SetReplay(replay);
+  }
+  device->SetControllerCount(options.controllers);
+  device->SetRenderSize(options.width, options.height);
+  device->InitializeGL();
+  world->RegisterDeviceDelegate(device);
+  world->InitializeHeadless(1.0f);
+  world->InitializeGL();
+  world->GetHiddenAreaMask()->SetLensRadius(options.lensRadius);
+  world->GetResolutionGovernor()->SetRange(options.minScale, 1.0f);
+  world->Resume();
+  if (!options.recordPath.empty() && !world->StartInputRecording(options.recordPath)) {
+    return 1;
+  }
+
+  for (int32_t frame = 0; frame < options.warmup; frame++) {
+    world->Draw();
+  }
+  world->GetFrameHistogram()->Reset();
+  GLStateCache::ResetCounters();
+  EyeBufferHints::ResetCounters();
+  world->GetHiddenAreaMask()->ResetCounters();
+  if (!options.tracePath.empty()) {
+    Trace::Start();
+  }
+
+  FrameTimingsPtr timings = world->GetFrameTimings();
+  double phaseTotals[FrameTimings::kPhaseCount] = {};
+  std::vector<double> samples;
+  samples.reserve((size_t)options.frames);
+  for (int32_t frame = 0; frame < options.frames; frame++) {
+    const auto start = std::chrono::steady_clock::now();
+    world->Draw();
+    const auto end = std::chrono::steady_clock::now();
+    samples.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    FrameTimings::Record record;
+    if (timings->GetRecentRecords(&record, 1) == 1) {
+      for (int32_t phase = 0; phase < FrameTimings::kPhaseCount; phase++) {
+        phaseTotals[phase] += (double)record.phases[phase] / 1000.0;
+      }
+    }
+  }
+  VRB_GL_CHECK(glFinish());
+  world->StopInputRecording();
+  if (!options.tracePath.empty()) {
+    Trace::Stop();
+    Trace::Write(options.tracePath);
+  }
+
+  double total = 0.0;
+  for (double sample: samples) {
+    total += sample;
+  }
+  std::sort(samples.begin(), samples.end());
+  printf("frames: %d controllers: %d size: %dx%d\n", options.frames, options.controllers,
+         options.width, options.height);
+  printf("Draw us/frame: mean %.2f min %.2f p50 %.2f p95 %.2f p99 %.2f max %.2f\n",
+         total / (double)samples.size(), samples.front(), Percentile(samples, 0.5),
+         Percentile(samples, 0.95), Percentile(samples, 0.99), samples.back());
+  FrameHistogram::Snapshot stats;
+  world->GetFrameHistogram()->GetSnapshot(stats);
+  printf("Frame interval ms: p50 %.2f p95 %.2f p99 %.2f missed %.0f dropped %.0f (period %.2f)\n",
+         stats.p50, stats.p95, stats.p99, stats.missedFrames, stats.droppedFrames, stats.displayPeriod);
+  for (int32_t phase = 0; phase < FrameTimings::kPhaseCount; phase++) {
+    printf("  %-18s mean %.2f us\n", FrameTimings::GetPhaseName((FrameTimings::Phase)phase),
+           phaseTotals[phase] / (double)samples.size());
+  }
+  GLStateCache::Counters counters;
+  GLStateCache::GetCounters(counters);
+  printf("GL state calls/frame: issued %.2f elided %.2f\n",
+         (double)counters.issued / (double)samples.size(), (double)counters.elided / (double)samples.size());
+  printf("Eye buffer write back avoided: %.2f MB/frame\n",
+         (double)EyeBufferHints::GetBytesAvoided() / (1024.0 * 1024.0) / (double)samples.size());
+  printf("Render scale: %.2f\n", world->GetResolutionGovernor()->GetScale());
+  if (world->GetHiddenAreaMask()->IsEnabled()) {
+    printf("Hidden area: %.1f%% of each eye, %.0f pixels/frame masked\n",
+           world->GetHiddenAreaMask()->GetCoverage(DeviceDelegate::CameraEnum::Left) * 100.0f,
+           (double)world->GetHiddenAreaMask()->GetMaskedPixels() / (double)samples.size());
+  }
+
+  world->Pause();
+  world->ShutdownGL();
+  device->ShutdownGL();
+  world->RegisterDeviceDelegate(nullptr);
+  world = nullptr;
+  device = nullptr;
+  egl->Destroy();
+  return 0;
+}
@@ -0,0 +1,246 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Checks that the hidden area mask only removes pixels outside the lens. Each
+// sampled frame is drawn twice from the same pose, without and with the mask,
+// and both eyes are read back. Pixels well inside the lens circle must match
+// exactly and pixels well outside the mask polygon must either match or hold
+// the clear color. Pixels within a pixel or two of the mask edge are skipped.
+// Exits with a non-zero status if any pixel fails.
+
+#include "BrowserWorld.h"
+#include "DeviceDelegateHeadless.h"
+#include "HeadlessEGLContext.h"
+#include "WidgetPlacement.h"
+#include "vrb/GLError.h"
+#include "vrb/Logger.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace crow;
+
+namespace {
+
+// Must match the segment count in HiddenAreaMask.cpp.
+const int32_t kLensSegments = 64;
+// Pixels this close to the mask edge may be partly covered.
+const float kEdgeMargin = 1.5f;
+const int32_t kSampledFrames[] = {0, 37, 113, 251};
+const DeviceDelegate::CameraEnum kEyes[] = {DeviceDelegate::CameraEnum::Left, DeviceDelegate::CameraEnum::Right};
+// InitializeHeadless creates the browser window before any other widget, so it
+// always receives the first widget handle.
+const int32_t kBrowserHandle = 0;
+const int32_t kWidgetTypeKeyboard = 2;
+const int32_t kGridColumns = 24;
+const int32_t kGridRows = 16;
+
+struct Options {
+  int32_t warmup = 120;
+  int32_t width = 512;
+  int32_t height = 512;
+  float lensRadius = 0.9f;
+};
+
+struct Result {
+  int64_t inside;
+  int64_t outside;
+  int64_t hidden; // Outside pixels the mask changed to the clear color.
+  int64_t failed;
+};
+
+bool
+ParseOptions(int aArgc, char* aArgv[], Options& aOptions) {
+  for (int index = 1; index < aArgc; index++) {
+    const char* arg = aArgv[index];
+    const char* value = (index + 1) < aArgc ? aArgv[index + 1] : nullptr;
+    if (!value) {
+      return false;
+    }
+    if (strcmp(arg, "--warmup") == 0) {
+      aOptions.warmup = atoi(value);
+    } else if (strcmp(arg, "--size") == 0) {
+      if (sscanf(value, "%dx%d", &aOptions.width, &aOptions.height) != 2) {
+        return false;
+      }
+    } else if (strcmp(arg, "--lens-radius") == 0) {
+      aOptions.lensRadius = (float)atof(value);
+    } else {
+      return false;
+    }
+    index++;
+  }
+  return (aOptions.width > 0) && (aOptions.height > 0) && (aOptions.lensRadius > 0.0f);
+}
+
+// Fills the view around the browser window so there is scene to mask in the
+// corners of both eyes.
+void
+AddWidgets(const BrowserWorldPtr& aWorld) {
+  WidgetPlacementPtr placement = WidgetPlacement::Create();
+  placement->widgetType = kWidgetTypeKeyboard;
+  placement->width = 100;
+  placement->height = 60;
+  placement->parentHandle = kBrowserHandle;
+  placement->parentAnchor = vrb::Vector(0.0f, 0.0f, 0.0f);
+  for (int32_t row = 0; row < kGridRows; row++) {
+    for (int32_t column = 0; column < kGridColumns; column++) {
+      placement->translation = vrb::Vector((float)(column - kGridColumns / 2) * 110.0f,
+                                           (float)(row - kGridRows / 2) * 70.0f,
+                                           (float)((row + column) % 3) * 40.0f + 20.0f);
+      aWorld->AddWidget(*placement, true, 0);
+    }
+  }
+}
+
+void
+GetClearColor(uint8_t aColor[4]) {
+  GLfloat color[4] = {};
+  VRB_GL_CHECK(glGetFloatv(GL_COLOR_CLEAR_VALUE, color));
+  for (int32_t channel = 0; channel < 4; channel++) {
+    aColor[channel] = (uint8_t)lroundf(fminf(fmaxf(color[channel], 0.0f), 1.0f) * 255.0f);
+  }
+}
+
+bool
+Matches(const uint8_t* aPixel, const uint8_t* aExpected) {
+  for (int32_t channel = 0; channel < 4; channel++) {
+    if (abs((int)aPixel[channel] - (int)aExpected[channel]) > 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void
+Compare(const Options& aOptions, const std::vector<uint8_t>& aUnmasked, const std::vector<uint8_t>& aMasked,
+        const uint8_t aClearColor[4], Result& aResult) {
+  // The radius is relative to half the viewport, so positions are normalized
+  // the same way. The margin is converted along the shorter axis.
+  const float halfWidth = (float)aOptions.width * 0.5f;
+  const float halfHeight = (float)aOptions.height * 0.5f;
+  const float margin = kEdgeMargin / fminf(halfWidth, halfHeight);
+  const float inner = aOptions.lensRadius - margin;
+  const float outer = aOptions.lensRadius / cosf((float)M_PI / (float)kLensSegments) + margin;
+  for (int32_t y = 0; y < aOptions.height; y++) {
+    const float ny = ((float)y + 0.5f - halfHeight) / halfHeight;
+    for (int32_t x = 0; x < aOptions.width; x++) {
+      const float nx = ((float)x + 0.5f - halfWidth) / halfWidth;
+      const float distance = sqrtf(nx * nx + ny * ny);
+      const size_t offset = ((size_t)y * (size_t)aOptions.width + (size_t)x) * 4;
+      const uint8_t* unmasked = &aUnmasked[offset];
+      const uint8_t* masked = &aMasked[offset];
+      const bool same = memcmp(unmasked, masked, 4) == 0;
+      if (distance < inner) {
+        aResult.inside++;
+        if (!same) {
+          aResult.failed++;
+        }
+      } else if (distance > outer) {
+        aResult.outside++;
+        if (same) {
+          continue;
+        } else if (Matches(masked, aClearColor)) {
+          aResult.hidden++;
+        } else {
+          aResult.failed++;
+        }
+      }
+    }
+  }
+}
+
+bool
+DrawAndRead(const BrowserWorldPtr& aWorld, const DeviceDelegateHeadlessPtr& aDevice, const uint32_t aFrame,
+            std::vector<uint8_t> aPixels[2]) {
+  aDevice->SetFrameIndex(aFrame);
+  aWorld->Draw();
+  for (int32_t eye = 0; eye < 2; eye++) {
+    if (!aDevice->ReadEye(kEyes[eye], aPixels[eye])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int
+main(int aArgc, char* aArgv[]) {
+  Options options;
+  if (!ParseOptions(aArgc, aArgv, options)) {
+    fprintf(stderr, "Usage: %s [--warmup N] [--size WIDTHxHEIGHT] [--lens-radius R]\n", aArgv[0]);
+    return 1;
+  }
+
+  HeadlessEGLContextPtr egl = HeadlessEGLContext::Create();
+  if (!egl->Initialize() || !egl->MakeCurrent()) {
+    VRB_LOG("Unable to create headless GL context");
+    return 1;
+  }
+
+  BrowserWorldPtr world = BrowserWorld::Create();
+  DeviceDelegateHeadlessPtr device = DeviceDelegateHeadless::Create(world->GetWeakContext());
+  device->SetRenderSize(options.width, options.height);
+  device->InitializeGL();
+  world->RegisterDeviceDelegate(device);
+  world->InitializeHeadless(1.0f);
+  world->InitializeGL();
+  // Both renders of a frame must be the same size.
+  world->GetResolutionGovernor()->SetRange(1.0f, 1.0f);
+  world->Resume();
+  AddWidgets(world);
+
+  // Lets deferred work such as the controller model load finish, so the two
+  // renders of a frame see the same scene.
+  for (int32_t frame = 0; frame < options.warmup; frame++) {
+    world->Draw();
+  }
+
+  Result result = {0, 0, 0, 0};
+  bool readFailed = false;
+  std::vector<uint8_t> unmasked[2];
+  std::vector<uint8_t> masked[2];
+  uint8_t clearColor[4];
+  for (const int32_t frame: kSampledFrames) {
+    world->GetHiddenAreaMask()->SetLensRadius(0.0f);
+    if (!DrawAndRead(world, device, (uint32_t)frame, unmasked)) {
+      readFailed = true;
+      break;
+    }
+    world->GetHiddenAreaMask()->SetLensRadius(options.lensRadius);
+    if (!DrawAndRead(world, device, (uint32_t)frame, masked)) {
+      readFailed = true;
+      break;
+    }
+    GetClearColor(clearColor);
+    for (int32_t eye = 0; eye < 2; eye++) {
+      Compare(options, unmasked[eye], masked[eye], clearColor, result);
+    }
+  }
+
+  world->Pause();
+  world->ShutdownGL();
+  device->ShutdownGL();
+  world->RegisterDeviceDelegate(nullptr);
+  world = nullptr;
+  device = nullptr;
+  egl->Destroy();
+
+  if (readFailed) {
+    fprintf(stderr, "Unable to read back the eye buffers\n");
+    return 1;
+  }
+  printf("lens radius %.2f size %dx%d: %lld inside, %lld outside (%lld hidden), %lld failed\n",
+         options.lensRadius, options.width, options.height, (long long)result.inside,
+         (long long)result.outside, (long long)result.hidden, (long long)result.failed);
+  if (result.hidden == 0) {
+    printf("Warning: the mask hid no scene pixels, so only the lens interior was checked\n");
+  }
+  return result.failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,324 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Micro-benchmarks for the math that BrowserWorld runs every frame. Each case
+// runs a fixed number of iterations over a small table of precomputed inputs
+// and reports the median of several runs as ns/op, along with the number of
+// heap allocations per operation.
+
+#include "ElbowModel.h"
+#include "Widget.h"
+#include "WidgetHitTable.h"
+#include "WidgetPlacement.h"
+#include "vrb/Context.h"
+#include "vrb/Matrix.h"
+#include "vrb/Vector.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+namespace {
+
+std::atomic<uint64_t> sAllocations(0);
+
+} // namespace
+
+void*
+operator new(size_t aSize) {
+  sAllocations.fetch_add(1, std::memory_order_relaxed);
+  void* result = malloc(aSize ? aSize : 1);
+  if (!result) {
+    throw std::bad_alloc();
+  }
+  return result;
+}
+
+void*
+operator new[](size_t aSize) {
+  return operator new(aSize);
+}
+
+void
+operator delete(void* aPointer) noexcept {
+  free(aPointer);
+}
+
+void
+operator delete[](void* aPointer) noexcept {
+  free(aPointer);
+}
+
+void
+operator delete(void* aPointer, size_t) noexcept {
+  free(aPointer);
+}
+
+void
+operator delete[](void* aPointer, size_t) noexcept {
+  free(aPointer);
+}
+
+using namespace crow;
+
+namespace {
+
+const int32_t kRuns = 7;
+const int32_t kInputCount = 256; // Power of two so the input index is a mask.
+const vrb::Vector kUp(0.0f, 1.0f, 0.0f);
+const vrb::Vector kRight(1.0f, 0.0f, 0.0f);
+const vrb::Vector kForward(0.0f, 0.0f, -1.0f);
+const int32_t kTableSize = 8;
+
+template <typename T>
+inline void
+DoNotOptimize(const T& aValue) {
+  asm volatile("" : : "r,m"(aValue) : "memory");
+}
+
+struct Options {
+  double scale = 1.0;
+  const char* filter = nullptr;
+};
+
+template <typename Function>
+void
+Run(const Options& aOptions, const char* aName, const int64_t aIterations, Function aFunction) {
+  if (aOptions.filter && !strstr(aName, aOptions.filter)) {
+    return;
+  }
+  const int64_t iterations = std::max<int64_t>(1, (int64_t)((double)aIterations * aOptions.scale));
+  // Warm caches and branch predictors before measuring.
+  for (int64_t index = 0; index < iterations / 10; index++) {
+    aFunction(index & (kInputCount - 1));
+  }
+  std::vector<double> samples;
+  uint64_t allocations = 0;
+  for (int32_t run = 0; run < kRuns; run++) {
+    const uint64_t allocationsBefore = sAllocations.load(std::memory_order_relaxed);
+    const auto start = std::chrono::steady_clock::now();
+    for (int64_t index = 0; index < iterations; index++) {
+      aFunction(index & (kInputCount - 1));
+    }
+    const auto end = std::chrono::steady_clock::now();
+    allocations += sAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+    samples.push_back(std::chrono::duration<double, std::nano>(end - start).count() / (double)iterations);
+  }
+  std::sort(samples.begin(), samples.end());
+  printf("%-44s %10.2f ns/op %8.2f allocs/op  (min %.2f max %.2f, %lld iterations)\n", aName,
+         samples[samples.size() / 2], (double)allocations / (double)(iterations * kRuns),
+         samples.front(), samples.back(), (long long)iterations);
+}
+
+bool
+ParseOptions(int aArgc, char* aArgv[], Options& aOptions) {
+  for (int index = 1; index < aArgc; index++) {
+    const char* arg = aArgv[index];
+    const char* value = (index + 1) < aArgc ? aArgv[index + 1] : nullptr;
+    if (!value) {
+      return false;
+    }
+    if (strcmp(arg, "--scale") == 0) {
+      aOptions.scale = atof(value);
+    } else if (strcmp(arg, "--filter") == 0) {
+      aOptions.filter = value;
+    } else {
+      return false;
+    }
+    index++;
+  }
+  return aOptions.scale > 0.0;
+}
+
+bool
+SameBits(const float aLeft, const float aRight) {
+  return memcmp(&aLeft, &aRight, sizeof(float)) == 0;
+}
+
+// Checks that the SIMD kernel matches the scalar kernel bit for bit, and that
+// both agree with Widget::TestControllerIntersection on what counts as a hit.
+bool
+VerifyHitTable(const std::vector<WidgetPtr>& aWidgets, const WidgetHitTablePtr& aTable,
+               const std::vector<vrb::Vector>& aStarts, const std::vector<vrb::Vector>& aDirections) {
+  const int32_t count = (int32_t)aWidgets.size();
+  std::vector<WidgetHitTable::Hit> simd(count), scalar(count);
+  int32_t failures = 0;
+  for (size_t ray = 0; ray < aStarts.size(); ray++) {
+    for (int32_t first = 0; first < count; first++) {
+      const int32_t length = count - first;
+      aTable->Intersect(aStarts[ray], aDirections[ray], first, length, simd.data());
+      aTable->IntersectScalar(aStarts[ray], aDirections[ray], first, length, scalar.data());
+      for (int32_t index = 0; index < length; index++) {
+        const WidgetHitTable::Hit& left = simd[index];
+        const WidgetHitTable::Hit& right = scalar[index];
+        vrb::Vector point;
+        bool isInWidget = false;
+        float distance = 0.0f;
+        const bool hit = aWidgets[first + index]->TestControllerIntersection(aStarts[ray], aDirections[ray],
+                                                                            point, isInWidget, distance);
+        bool matches = (left.hit == right.hit) && (left.inWidget == right.inWidget) &&
+                       SameBits(left.distance, right.distance) && (left.hit == hit) &&
+                       (left.inWidget == isInWidget);
+        if (matches && left.hit) {
+          matches = SameBits(left.point.x(), right.point.x()) && SameBits(left.point.y(), right.point.y()) &&
+                    SameBits(left.point.z(), right.point.z()) &&
+                    (fabsf(left.distance - distance) <= 0.0001f * std::max(1.0f, distance));
+        }
+        if (!matches && (failures++ < 10)) {
+          fprintf(stderr, "WidgetHitTable mismatch: ray %d widget %d\n", (int)ray, first + index);
+        }
+      }
+    }
+  }
+  return failures == 0;
+}
+
+float
+Random(uint32_t& aSeed) {
+  // Fixed LCG so every run sees the same inputs.
+  aSeed = aSeed * 1664525u + 1013904223u;
+  return (float)(aSeed >> 8) / (float)(1u << 24);
+}
+
+} // namespace
+
+int
+main(int aArgc, char* aArgv[]) {
+  Options options;
+  if (!ParseOptions(aArgc, aArgv, options)) {
+    fprintf(stderr, "Usage: %s [--scale FACTOR] [--filter SUBSTRING]\n", aArgv[0]);
+    return 1;
+  }
+
+  vrb::ContextPtr context = vrb::Context::Create();
+  vrb::ContextWeak contextWeak = context;
+  WidgetPtr parent = Widget::Create(contextWeak, 0);
+  parent->SetTransform(vrb::Matrix::Position(vrb::Vector(0.0f, -3.0f, -18.0f)));
+  WidgetPtr widget = Widget::Create(contextWeak, 1, 720, 103, 720.0f * kWorldDPIRatio);
+  widget->SetTransform(vrb::Matrix::Rotation(kUp, 0.3f).Translate(vrb::Vector(0.0f, 7.15f, -18.0f)));
+  ElbowModelPtr elbow = ElbowModel::Create();
+
+  // Controller rays aimed around the widget so that roughly half of them hit.
+  uint32_t seed = 1;
+  std::vector<vrb::Vector> starts(kInputCount);
+  std::vector<vrb::Vector> directions(kInputCount);
+  std::vector<vrb::Vector> hits(kInputCount);
+  std::vector<vrb::Matrix> rotations(kInputCount);
+  std::vector<vrb::Matrix> heads(kInputCount);
+  for (int32_t index = 0; index < kInputCount; index++) {
+    const float yaw = (Random(seed) - 0.5f) * 1.2f;
+    const float pitch = (Random(seed) - 0.2f) * 0.8f;
+    rotations[index] = vrb::Matrix::Rotation(kUp, yaw).PostMultiply(vrb::Matrix::Rotation(kRight, pitch));
+    heads[index] = vrb::Matrix::Rotation(kUp, yaw * 0.5f).Translate(vrb::Vector(0.0f, 1.7f, 0.0f));
+    starts[index] = vrb::Vector(0.2f, 1.4f, -0.3f);
+    directions[index] = rotations[index].MultiplyDirection(kForward);
+    bool isInWidget = false;
+    float distance = 0.0f;
+    widget->TestControllerIntersection(starts[index], directions[index], hits[index], isInWidget, distance);
+  }
+  WidgetPlacementPtr placement = WidgetPlacement::Create();
+  placement->width = 720;
+  placement->height = 103;
+  placement->translation = vrb::Vector(0.0f, 40.0f, 10.0f);
+  placement->rotationAxis = kRight;
+  placement->rotation = 0.2f;
+  placement->anchor = vrb::Vector(0.5f, 0.0f, 0.0f);
+  placement->parentAnchor = vrb::Vector(0.5f, 1.0f, 0.0f);
+  float parentWidth = 0.0f, parentHeight = 0.0f;
+  float worldWidth = 0.0f, worldHeight = 0.0f;
+  parent->GetWorldSize(parentWidth, parentHeight);
+  widget->GetWorldSize(worldWidth, worldHeight);
+  const vrb::Matrix parentTransform = parent->GetTransform();
+
+  // A fan of widgets around the user, as tested against each controller ray
+  // every frame.
+  std::vector<WidgetPtr> fan;
+  WidgetHitTablePtr table = WidgetHitTable::Create();
+  table->SetCount(kTableSize);
+  for (int32_t index = 0; index < kTableSize; index++) {
+    WidgetPtr item = Widget::Create(contextWeak, 2, 400, 300, 400.0f * kWorldDPIRatio);
+    const float angle = ((float)index - (float)kTableSize * 0.5f) * 0.15f;
+    item->SetTransform(vrb::Matrix::Rotation(kUp, angle).Translate(
+        vrb::Vector(sinf(angle) * -18.0f, (float)(index % 3) * 4.0f - 2.0f, cosf(angle) * -18.0f)));
+    table->SetWidget(index, *item);
+    fan.push_back(item);
+  }
+  if (!VerifyHitTable(fan, table, starts, directions)) {
+    return 1;
+  }
+
+  Run(options, "Widget::TestControllerIntersection", 2000000, [&](const int32_t aIndex) {
+    vrb::Vector result;
+    bool isInWidget = false;
+    float distance = 0.0f;
+    DoNotOptimize(widget->TestControllerIntersection(starts[aIndex], directions[aIndex], result, isInWidget, distance));
+    DoNotOptimize(result);
+  });
+
+  Run(options, "Widget::TestControllerIntersection x8", 500000, [&](const int32_t aIndex) {
+    for (const WidgetPtr& item: fan) {
+      vrb::Vector result;
+      bool isInWidget = false;
+      float distance = 0.0f;
+      DoNotOptimize(item->TestControllerIntersection(starts[aIndex], directions[aIndex], result, isInWidget, distance));
+      DoNotOptimize(result);
+    }
+  });
+
+  Run(options, "WidgetHitTable::IntersectScalar x8", 500000, [&](const int32_t aIndex) {
+    WidgetHitTable::Hit hits[kTableSize];
+    table->IntersectScalar(starts[aIndex], directions[aIndex], 0, kTableSize, hits);
+    DoNotOptimize(hits);
+  });
+
+  Run(options, "WidgetHitTable::Intersect x8", 500000, [&](const int32_t aIndex) {
+    WidgetHitTable::Hit hits[kTableSize];
+    table->Intersect(starts[aIndex], directions[aIndex], 0, kTableSize, hits);
+    DoNotOptimize(hits);
+  });
+
+  Run(options, "Widget::ConvertToWidgetCoordinates", 2000000, [&](const int32_t aIndex) {
+    float x = 0.0f, y = 0.0f;
+    widget->ConvertToWidgetCoordinates(hits[aIndex], x, y);
+    DoNotOptimize(x);
+    DoNotOptimize(y);
+  });
+
+  Run(options, "ElbowModel::GetTransform", 2000000, [&](const int32_t aIndex) {
+    const vrb::Matrix& result = elbow->GetTransform(
+        (aIndex & 1) ? ElbowModel::HandEnum::Left : ElbowModel::HandEnum::Right, heads[aIndex], rotations[aIndex]);
+    DoNotOptimize(result);
+  });
+
+  Run(options, "WidgetPlacement::GetTransform", 2000000, [&](const int32_t aIndex) {
+    placement->rotation = (float)aIndex * 0.001f;
+    const vrb::Matrix result = placement->GetTransform(parentTransform, parentWidth, parentHeight,
+                                                       worldWidth, worldHeight);
+    DoNotOptimize(result);
+  });
+
+  Run(options, "vrb::Matrix::AfineInverse", 5000000, [&](const int32_t aIndex) {
+    const vrb::Matrix result = heads[aIndex].AfineInverse();
+    DoNotOptimize(result);
+  });
+
+  Run(options, "vrb::Matrix::PostMultiply", 5000000, [&](const int32_t aIndex) {
+    const vrb::Matrix result = heads[aIndex].PostMultiply(rotations[aIndex]);
+    DoNotOptimize(result);
+  });
+
+  Run(options, "vrb::Matrix::MultiplyPosition", 10000000, [&](const int32_t aIndex) {
+    const vrb::Vector result = heads[aIndex].MultiplyPosition(starts[aIndex]);
+    DoNotOptimize(result);
+  });
+
+  return 0;
+}
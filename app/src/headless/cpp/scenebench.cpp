@@ -0,0 +1,303 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Measures how the cost of a frame grows with the number of widgets and
+// controllers. Widgets are added through BrowserWorld::AddWidget in the same
+// way the Java side adds them, and the per-phase frame timings are averaged
+// for every scene. Results can be written as JSON and compared against a
+// previously stored baseline.
+
+#include "BrowserWorld.h"
+#include "DeviceDelegateHeadless.h"
+#include "FrameTimings.h"
+#include "HeadlessEGLContext.h"
+#include "WidgetPlacement.h"
+#include "vrb/GLError.h"
+#include "vrb/Logger.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace crow;
+
+namespace {
+
+const int32_t kWidgetCounts[] = {1, 10, 100, 1000};
+const int32_t kMaxControllers = 4;
+// InitializeHeadless creates the browser window before any other widget, so it
+// always receives the first widget handle.
+const int32_t kBrowserHandle = 0;
+const int32_t kWidgetTypeKeyboard = 2;
+const int32_t kGridColumns = 40;
+// Differences below this are treated as noise when comparing with a baseline.
+const double kNoiseFloor = 2.0; // Microseconds.
+
+struct Options {
+  int32_t frames = 200;
+  int32_t warmup = 30;
+  double threshold = 0.1;
+  std::string outputPath;
+  std::string baselinePath;
+};
+
+struct Result {
+  int32_t widgets;
+  int32_t controllers;
+  double updateControllers; // Microseconds per frame.
+  double cull;
+  double draw;
+  double frame;
+};
+
+bool
+ParseOptions(int aArgc, char* aArgv[], Options& aOptions) {
+  for (int index = 1; index < aArgc; index++) {
+    const char* arg = aArgv[index];
+    const char* value = (index + 1) < aArgc ? aArgv[index + 1] : nullptr;
+    if (!value) {
+      return false;
+    }
+    if (strcmp(arg, "--frames") == 0) {
+      aOptions.frames = atoi(value);
+    } else if (strcmp(arg, "--warmup") == 0) {
+      aOptions.warmup = atoi(value);
+    } else if (strcmp(arg, "--threshold") == 0) {
+      aOptions.threshold = atof(value);
+    } else if (strcmp(arg, "--output") == 0) {
+      aOptions.outputPath = value;
+    } else if (strcmp(arg, "--baseline") == 0) {
+      aOptions.baselinePath = value;
+    } else {
+      return false;
+    }
+    index++;
+  }
+  return (aOptions.frames > 0) && (aOptions.threshold >= 0.0);
+}
+
+void
+AddWidgets(const BrowserWorldPtr& aWorld, const int32_t aFirst, const int32_t aCount) {
+  // Lay the widgets out in a grid that fills the area around the browser
+  // window, alternating depth so rays often cross several of them.
+  WidgetPlacementPtr placement = WidgetPlacement::Create();
+  placement->widgetType = kWidgetTypeKeyboard;
+  placement->width = 100;
+  placement->height = 60;
+  placement->parentHandle = kBrowserHandle;
+  placement->parentAnchor = vrb::Vector(0.0f, 0.0f, 0.0f);
+  for (int32_t index = aFirst; index < aCount; index++) {
+    const int32_t column = index % kGridColumns;
+    const int32_t row = index / kGridColumns;
+    placement->translation = vrb::Vector((float)column * 110.0f - 1100.0f,
+                                         (float)row * 70.0f - 300.0f,
+                                         (float)(index % 3) * 40.0f + 20.0f);
+    aWorld->AddWidget(*placement, true, 0);
+  }
+}
+
+Result
+Measure(const BrowserWorldPtr& aWorld, const Options& aOptions, const int32_t aWidgets, const int32_t aControllers) {
+  DeviceDelegateHeadlessPtr device = DeviceDelegateHeadless::Create(aWorld->GetWeakContext());
+  device->SetControllerCount(aControllers);
+  device->InitializeGL();
+  aWorld->RegisterDeviceDelegate(device);
+  for (int32_t frame = 0; frame < aOptions.warmup; frame++) {
+    aWorld->Draw();
+  }
+
+  FrameTimingsPtr timings = aWorld->GetFrameTimings();
+  Result result = {aWidgets, aControllers, 0.0, 0.0, 0.0, 0.0};
+  for (int32_t frame = 0; frame < aOptions.frames; frame++) {
+    aWorld->Draw();
+    FrameTimings::Record record;
+    if (timings->GetRecentRecords(&record, 1) != 1) {
+      continue;
+    }
+    result.updateControllers += (double)record.phases[(int32_t)FrameTimings::Phase::UpdateControllers];
+    result.cull += (double)record.phases[(int32_t)FrameTimings::Phase::Cull];
+    result.draw += (double)(record.phases[(int32_t)FrameTimings::Phase::DrawLeft] +
+                            record.phases[(int32_t)FrameTimings::Phase::DrawRight]);
+    for (int32_t phase = 0; phase < FrameTimings::kPhaseCount; phase++) {
+      result.frame += (double)record.phases[phase];
+    }
+  }
+  VRB_GL_CHECK(glFinish());
+  const double scale = 1000.0 * (double)aOptions.frames;
+  result.updateControllers /= scale;
+  result.cull /= scale;
+  result.draw /= scale;
+  result.frame /= scale;
+
+  aWorld->RegisterDeviceDelegate(nullptr);
+  device->ShutdownGL();
+  return result;
+}
+
+// Each scene is written on its own line so the baseline can be read back
+// without a JSON library.
+const char* kSceneFormat =
+    "{\"widgets\": %d, \"controllers\": %d, \"updateControllers\": %lf, \"cull\": %lf, \"draw\": %lf, \"frame\": %lf}";
+
+bool
+WriteResults(const std::string& aPath, const std::vector<Result>& aResults) {
+  FILE* file = fopen(aPath.c_str(), "w");
+  if (!file) {
+    VRB_LOG("Unable to write results: %s", aPath.c_str());
+    return false;
+  }
+  fprintf(file, "{\"scenes\": [\n");
+  for (size_t index = 0; index < aResults.size(); index++) {
+    const Result& result = aResults[index];
+    fprintf(file, "  ");
+    fprintf(file, kSceneFormat, result.widgets, result.controllers, result.updateControllers,
+            result.cull, result.draw, result.frame);
+    fprintf(file, "%s\n", (index + 1) < aResults.size() ? "," : "");
+  }
+  fprintf(file, "]}\n");
+  fclose(file);
+  return true;
+}
+
+bool
+ReadResults(const std::string& aPath, std::vector<Result>& aResults) {
+  FILE* file = fopen(aPath.c_str(), "r");
+  if (!file) {
+    VRB_LOG("Unable to read baseline: %s", aPath.c_str());
+    return false;
+  }
+  char line[512];
+  while (fgets(line, sizeof(line), file)) {
+    const char* start = strchr(line, '{');
+    if (!start || (strncmp(start, "{\"widgets\"", 10) != 0)) {
+      continue;
+    }
+    Result result;
+    if (sscanf(start, kSceneFormat, &result.widgets, &result.controllers, &result.updateControllers,
+               &result.cull, &result.draw, &result.frame) == 6) {
+      aResults.push_back(result);
+    }
+  }
+  fclose(file);
+  return !aResults.empty();
+}
+
+bool
+CheckMetric(const char* aName, const Result& aResult, const double aCurrent, const double aBaseline,
+            const double aThreshold) {
+  if ((aCurrent - aBaseline) <= kNoiseFloor || (aCurrent <= aBaseline * (1.0 + aThreshold))) {
+    return true;
+  }
+  printf("REGRESSION widgets %4d controllers %d %-18s %9.2f us -> %9.2f us (%+.1f%%)\n",
+         aResult.widgets, aResult.controllers, aName, aBaseline, aCurrent,
+         (aCurrent / aBaseline - 1.0) * 100.0);
+  return false;
+}
+
+int32_t
+Compare(const std::vector<Result>& aResults, const std::vector<Result>& aBaseline, const double aThreshold) {
+  int32_t regressions = 0;
+  for (const Result& result: aResults) {
+    for (const Result& baseline: aBaseline) {
+      if ((baseline.widgets != result.widgets) || (baseline.controllers != result.controllers)) {
+        continue;
+      }
+      regressions += CheckMetric("UpdateControllers", result, result.updateControllers,
+                                 baseline.updateControllers, aThreshold) ? 0 : 1;
+      regressions += CheckMetric("Cull", result, result.cull, baseline.cull, aThreshold) ? 0 : 1;
+      regressions += CheckMetric("Draw", result, result.draw, baseline.draw, aThreshold) ? 0 : 1;
+      regressions += CheckMetric("Frame", result, result.frame, baseline.frame, aThreshold) ? 0 : 1;
+    }
+  }
+  return regressions;
+}
+
+void
+PrintCurves(const std::vector<Result>& aResults) {
+  printf("%8s %12s %18s %12s %12s %12s\n", "widgets", "controllers", "UpdateControllers", "Cull", "Draw", "Frame");
+  for (const Result& result: aResults) {
+    printf("%8d %12d %15.2f us %9.2f us %9.2f us %9.2f us\n", result.widgets, result.controllers,
+           result.updateControllers, result.cull, result.draw, result.frame);
+  }
+  // Growth per tenfold increase in widgets. A linear algorithm approaches 10x.
+  printf("\nGrowth per 10x widgets (UpdateControllers / Cull / Draw):\n");
+  for (const Result& result: aResults) {
+    for (const Result& previous: aResults) {
+      if ((previous.controllers != result.controllers) || (previous.widgets * 10 != result.widgets)) {
+        continue;
+      }
+      printf("  controllers %d, %4d -> %4d widgets: %5.2fx / %5.2fx / %5.2fx\n", result.controllers,
+             previous.widgets, result.widgets,
+             result.updateControllers / std::max(previous.updateControllers, 0.001),
+             result.cull / std::max(previous.cull, 0.001),
+             result.draw / std::max(previous.draw, 0.001));
+    }
+  }
+}
+
+} // namespace
+
+int
+main(int aArgc, char* aArgv[]) {
+  Options options;
+  if (!ParseOptions(aArgc, aArgv, options)) {
+    fprintf(stderr, "Usage: %s [--frames N] [--warmup N] [--output FILE] [--baseline FILE] [--threshold FRACTION]\n",
+            aArgv[0]);
+    return 1;
+  }
+
+  HeadlessEGLContextPtr egl = HeadlessEGLContext::Create();
+  if (!egl->Initialize() || !egl->MakeCurrent()) {
+    VRB_LOG("Unable to create headless GL context");
+    return 1;
+  }
+
+  BrowserWorldPtr world = BrowserWorld::Create();
+  DeviceDelegateHeadlessPtr device = DeviceDelegateHeadless::Create(world->GetWeakContext());
+  world->RegisterDeviceDelegate(device);
+  world->InitializeHeadless(1.0f);
+  world->InitializeGL();
+  world->RegisterDeviceDelegate(nullptr);
+  world->Resume();
+
+  std::vector<Result> results;
+  int32_t widgets = 0;
+  for (const int32_t count: kWidgetCounts) {
+    AddWidgets(world, widgets, count);
+    widgets = count;
+    for (int32_t controllers = 1; controllers <= kMaxControllers; controllers++) {
+      results.push_back(Measure(world, options, widgets, controllers));
+    }
+  }
+  PrintCurves(results);
+
+  int result = 0;
+  if (!options.outputPath.empty() && !WriteResults(options.outputPath, results)) {
+    result = 1;
+  }
+  if (!options.baselinePath.empty()) {
+    std::vector<Result> baseline;
+    if (!ReadResults(options.baselinePath, baseline)) {
+      result = 1;
+    } else {
+      const int32_t regressions = Compare(results, baseline, options.threshold);
+      printf("%d regression(s) above %.0f%% compared to %s\n", regressions, options.threshold * 100.0,
+             options.baselinePath.c_str());
+      if (regressions > 0) {
+        result = 2;
+      }
+    }
+  }
+
+  world->Pause();
+  world->ShutdownGL();
+  world = nullptr;
+  device = nullptr;
+  egl->Destroy();
+  return result;
+}
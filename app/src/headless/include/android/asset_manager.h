@@ -0,0 +1,33 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Host replacement for the NDK asset manager. There is no APK on the host so
+// every asset lookup fails and the vrb file reader reports a missing file.
+
+#ifndef VRBROWSER_HEADLESS_ANDROID_ASSET_MANAGER_H
+#define VRBROWSER_HEADLESS_ANDROID_ASSET_MANAGER_H
+
+#include <sys/types.h>
+
+struct AAssetManager;
+typedef struct AAssetManager AAssetManager;
+struct AAsset;
+typedef struct AAsset AAsset;
+
+enum {
+  AASSET_MODE_UNKNOWN = 0,
+  AASSET_MODE_RANDOM = 1,
+  AASSET_MODE_STREAMING = 2,
+  AASSET_MODE_BUFFER = 3
+};
+
+static inline AAsset* AAssetManager_open(AAssetManager*, const char*, int) { return nullptr; }
+static inline int AAsset_read(AAsset*, void*, size_t) { return -1; }
+static inline off_t AAsset_getLength(AAsset*) { return 0; }
+static inline off_t AAsset_getRemainingLength(AAsset*) { return 0; }
+static inline const void* AAsset_getBuffer(AAsset*) { return nullptr; }
+static inline void AAsset_close(AAsset*) {}
+
+#endif // VRBROWSER_HEADLESS_ANDROID_ASSET_MANAGER_H
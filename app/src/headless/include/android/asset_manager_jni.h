@@ -0,0 +1,14 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_HEADLESS_ANDROID_ASSET_MANAGER_JNI_H
+#define VRBROWSER_HEADLESS_ANDROID_ASSET_MANAGER_JNI_H
+
+#include <jni.h>
+#include "android/asset_manager.h"
+
+static inline AAssetManager* AAssetManager_fromJava(JNIEnv*, jobject) { return nullptr; }
+
+#endif // VRBROWSER_HEADLESS_ANDROID_ASSET_MANAGER_JNI_H
@@ -0,0 +1,42 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Host replacement for the NDK logging header. Log output goes to stderr.
+
+#ifndef VRBROWSER_HEADLESS_ANDROID_LOG_H
+#define VRBROWSER_HEADLESS_ANDROID_LOG_H
+
+#include <stdarg.h>
+#include <stdio.h>
+
+typedef enum android_LogPriority {
+  ANDROID_LOG_UNKNOWN = 0,
+  ANDROID_LOG_DEFAULT,
+  ANDROID_LOG_VERBOSE,
+  ANDROID_LOG_DEBUG,
+  ANDROID_LOG_INFO,
+  ANDROID_LOG_WARN,
+  ANDROID_LOG_ERROR,
+  ANDROID_LOG_FATAL,
+  ANDROID_LOG_SILENT
+} android_LogPriority;
+
+static inline int
+__android_log_print(int aPriority, const char* aTag, const char* aFormat, ...) {
+  va_list args;
+  va_start(args, aFormat);
+  fprintf(stderr, "%s: ", aTag);
+  const int result = vfprintf(stderr, aFormat, args);
+  fputc('\n', stderr);
+  va_end(args);
+  return result;
+}
+
+static inline int
+__android_log_write(int aPriority, const char* aTag, const char* aText) {
+  return fprintf(stderr, "%s: %s\n", aTag, aText);
+}
+
+#endif // VRBROWSER_HEADLESS_ANDROID_LOG_H
@@ -0,0 +1,122 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "AudioPoseChannel.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/Matrix.h"
+#include "vrb/Quaternion.h"
+#include "vrb/Vector.h"
+
+#include <atomic>
+#include <cmath>
+
+namespace crow {
+
+namespace {
+
+const int32_t kReadAttempts = 3;
+
+} // namespace
+
+struct AudioPoseChannel::State {
+  std::atomic<uint32_t> sequence;
+  // Atomic so the reader's loads race with the writer without undefined
+  // behavior. The sequence counter decides whether a copy is usable.
+  std::atomic<float> pose[kPoseSize];
+  float last[kPoseSize];
+  bool published;
+  float minDot; // Cosine of half the rotation threshold.
+  float distanceSquared;
+
+  State() : published(false), minDot(1.0f), distanceSquared(0.0f) {
+    sequence.store(0, std::memory_order_relaxed);
+    for (int32_t index = 0; index < kPoseSize; index++) {
+      pose[index].store(0.0f, std::memory_order_relaxed);
+      last[index] = 0.0f;
+    }
+  }
+
+  bool Changed(const float* aPose) const {
+    if (!published) {
+      return true;
+    }
+    if ((minDot >= 1.0f) && (distanceSquared <= 0.0f)) {
+      for (int32_t index = 0; index < kPoseSize; index++) {
+        if (aPose[index] != last[index]) {
+          return true;
+        }
+      }
+      return false;
+    }
+    float dot = 0.0f;
+    for (int32_t index = 0; index < 4; index++) {
+      dot += aPose[index] * last[index];
+    }
+    float distance = 0.0f;
+    for (int32_t index = 4; index < kPoseSize; index++) {
+      distance += (aPose[index] - last[index]) * (aPose[index] - last[index]);
+    }
+    // q and -q are the same rotation.
+    return (std::fabs(dot) < minDot) || (distance > distanceSquared);
+  }
+};
+
+AudioPoseChannelPtr
+AudioPoseChannel::Create() {
+  return std::make_shared<vrb::ConcreteClass<AudioPoseChannel, AudioPoseChannel::State> >();
+}
+
+void
+AudioPoseChannel::SetThreshold(const float aRotation, const float aDistance) {
+  m.minDot = aRotation > 0.0f ? std::cos(aRotation * 0.5f) : 1.0f;
+  m.distanceSquared = aDistance > 0.0f ? aDistance * aDistance : 0.0f;
+}
+
+bool
+AudioPoseChannel::Publish(const vrb::Matrix& aHeadTransform) {
+  const vrb::Quaternion q(aHeadTransform);
+  const vrb::Vector p = aHeadTransform.GetTranslation();
+  const float pose[kPoseSize] = {q.x(), q.y(), q.z(), q.w(), p.x(), p.y(), p.z()};
+  if (!m.Changed(pose)) {
+    return false;
+  }
+  const uint32_t sequence = m.sequence.load(std::memory_order_relaxed);
+  m.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (int32_t index = 0; index < kPoseSize; index++) {
+    m.pose[index].store(pose[index], std::memory_order_relaxed);
+    m.last[index] = pose[index];
+  }
+  m.sequence.store(sequence + 2, std::memory_order_release);
+  m.published = true;
+  return true;
+}
+
+int32_t
+AudioPoseChannel::Read(float* aPose) const {
+  for (int32_t attempt = 0; attempt < kReadAttempts; attempt++) {
+    const uint32_t before = m.sequence.load(std::memory_order_acquire);
+    if (before == 0) {
+      return -1;
+    }
+    if (before & 1) {
+      continue;
+    }
+    for (int32_t index = 0; index < kPoseSize; index++) {
+      aPose[index] = m.pose[index].load(std::memory_order_relaxed);
+    }
+    // Keeps the pose loads above from moving after the second sequence load.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (m.sequence.load(std::memory_order_relaxed) == before) {
+      return (int32_t)(before >> 1);
+    }
+  }
+  return -1;
+}
+
+AudioPoseChannel::AudioPoseChannel(State& aState) : m(aState) {}
+AudioPoseChannel::~AudioPoseChannel() {}
+
+} // namespace crow
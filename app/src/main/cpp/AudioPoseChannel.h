@@ -0,0 +1,49 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_AUDIO_POSE_CHANNEL_DOT_H
+#define VRBROWSER_AUDIO_POSE_CHANNEL_DOT_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+
+namespace crow {
+
+class AudioPoseChannel;
+typedef std::shared_ptr<AudioPoseChannel> AudioPoseChannelPtr;
+
+// Publishes the latest head pose for the Java AudioEngine, which reads it at
+// its own rate. The pose is protected by a sequence counter: the writer makes
+// it odd while updating the pose, and a reader retries when the counter is odd
+// or changed during a read.
+class AudioPoseChannel {
+public:
+  // qx, qy, qz, qw, px, py, pz.
+  static const int32_t kPoseSize = 7;
+  static AudioPoseChannelPtr Create();
+  // Poses that differ from the last published one by less than both
+  // thresholds are not published. Zero publishes every change.
+  void SetThreshold(const float aRotation, const float aDistance);
+  // Called from the render thread. Returns true if the pose was published.
+  bool Publish(const vrb::Matrix& aHeadTransform);
+  // Safe to call from any thread. Copies the latest pose into aPose and
+  // returns how many poses have been published, or returns -1 if none has
+  // been or the writer kept it busy.
+  int32_t Read(float* aPose) const;
+protected:
+  struct State;
+  AudioPoseChannel(State& aState);
+  ~AudioPoseChannel();
+private:
+  State& m;
+  AudioPoseChannel() = delete;
+  VRB_NO_DEFAULTS(AudioPoseChannel)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_AUDIO_POSE_CHANNEL_DOT_H
@@ -4,8 +4,20 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include "BrowserWorld.h"
+#include "AudioPoseChannel.h"
 #include "ControllerDelegate.h"
+#include "EyeBufferHints.h"
+#include "FrameHistogram.h"
+#include "FrameTimings.h"
+#include "Frustum.h"
+#include "GLStateCache.h"
+#include "HiddenAreaMask.h"
+#include "InputRecorder.h"
+#include "ResolutionGovernor.h"
+#include "RunnableQueue.h"
+#include "Trace.h"
 #include "Widget.h"
+#include "WidgetBVH.h"
 #include "WidgetPlacement.h"
 #include "vrb/CameraSimple.h"
 #include "vrb/Color.h"
@@ -29,7 +41,8 @@
 #include "vrb/Transform.h"
 #include "vrb/VertexArray.h"
 #include "vrb/Vector.h"
-#include <functional>
+#include <algorithm>
+#include <unordered_map>
 
 using namespace vrb;
 
@@ -42,8 +55,39 @@ static const int WidgetTypeURLBar = 1;
 static const int GestureSwipeLeft = 0;
 static const int GestureSwipeRight = 1;
 
+// Must be kept in sync with VRBrowserActivity.java
+static const int32_t EventMotion = 0;
+static const int32_t EventScroll = 1;
+static const int32_t EventGesture = 2;
+static const int32_t kEventCapacity = 256;
+
+// Input events for the Java side are collected during a frame and handed over
+// in a single call. Every record has the same layout, read by
+// VRBrowserActivity.handleEventBatch in native byte order.
+struct EventRecord {
+  int32_t type;
+  int32_t handle; // Widget handle, unused for gestures.
+  int32_t device; // Controller index, unused for gestures.
+  int32_t value;  // Pressed for motion events, the gesture type for gestures.
+  float x;
+  float y;
+  // CLOCK_MONOTONIC time in nanoseconds at which the controller poses were
+  // sampled, the same clock as SystemClock.uptimeMillis().
+  int64_t time;
+};
+static_assert(sizeof(EventRecord) == 32, "EventRecord must match VRBrowserActivity.EventRecordSize");
+
 static const float kScrollFactor = 20.0f; // Just picked what fell right.
-static const float kWorldDPIRatio = 18.0f/720.0f;
+// Share of the display period queued Java work may take before a frame, if
+// the scheduler has that much slack left. Work left over runs before the next
+// frame.
+static const float kRunnableBudget = 0.25f;
+// Cost assumed for a controller model load until one has been measured.
+// Parsing a model takes several frames worth of time.
+static const int64_t kModelLoadEstimate = 50000000; // Nanoseconds.
+// Head movement after which the widgets are sorted again even if the scene
+// has not changed.
+static const float kResortDistance = 0.1f;
 
 static crow::BrowserWorld* sWorld;
 
@@ -51,14 +95,8 @@ static const char* kDispatchCreateWidgetName = "dispatchCreateWidget";
 static const char* kDispatchCreateWidgetSignature = "(IILandroid/graphics/SurfaceTexture;III)V";
 static const char* kGetDisplayDensityName = "getDisplayDensity";
 static const char* kGetDisplayDensitySignature = "()F";
-static const char* kHandleMotionEventName = "handleMotionEvent";
-static const char* kHandleMotionEventSignature = "(IIZFF)V";
-static const char* kHandleScrollEvent = "handleScrollEvent";
-static const char* kHandleScrollEventSignature = "(IIFF)V";
-static const char* kHandleAudioPoseName = "handleAudioPose";
-static const char* kHandleAudioPoseSignature = "(FFFFFFF)V";
-static const char* kHandleGestureName = "handleGesture";
-static const char* kHandleGestureSignature = "(I)V";
+static const char* kHandleEventBatchName = "handleEventBatch";
+static const char* kHandleEventBatchSignature = "(Ljava/nio/ByteBuffer;I)V";
 static const char* kTileTexture = "tile.png";
 class SurfaceObserver;
 typedef std::shared_ptr<SurfaceObserver> SurfaceObserverPtr;
@@ -120,6 +158,8 @@ struct Controller {
   float lastTouchY;
   float scrollDeltaX;
   float scrollDeltaY;
+  int32_t modelIndex;
+  bool visible;
   TransformPtr transform;
   Matrix transformMatrix;
   
@@ -130,6 +170,7 @@ struct Controller {
                  touchX(0.0f), touchY(0.0f),
                  lastTouchX(0.0f), lastTouchY(0.0f),
                  scrollDeltaX(0.0f), scrollDeltaY(0.0f),
+                 modelIndex(-1), visible(false),
                  transformMatrix(Matrix::Identity()) {}
 
   Controller(const Controller& aController) {
@@ -156,6 +197,8 @@ struct Controller {
     lastTouchY = aController.lastTouchY;
     scrollDeltaX = aController.scrollDeltaX;
     scrollDeltaY = aController.scrollDeltaY;
+    modelIndex = aController.modelIndex;
+    visible = aController.visible;
     transform = aController.transform;
     transformMatrix = aController.transformMatrix;
     return *this;
@@ -171,6 +214,8 @@ struct Controller {
     touchX = touchY = 0.0f;
     lastTouchX = lastTouchY = 0.0f;
     scrollDeltaX = scrollDeltaY = 0.0f;
+    modelIndex = -1;
+    visible = false;
     if (transform) {
       transform = nullptr;
     }
@@ -239,6 +284,7 @@ ControllerContainer::CreateController(const int32_t aControllerIndex, const int3
   controller.index = aControllerIndex;
   if (!controller.transform && (aModelIndex >= 0)) {
     SetUpModelsGroup(aModelIndex);
+    controller.modelIndex = aModelIndex;
     controller.transform = Transform::Create(context);
     if ((models.size() >= aModelIndex) && models[aModelIndex]) {
       controller.transform->AddNode(models[aModelIndex]);
@@ -279,6 +325,7 @@ ControllerContainer::SetVisible(const int32_t aControllerIndex, const bool aVisi
     return;
   }
   Controller& controller = list[aControllerIndex];
+  controller.visible = aVisible;
   if (controller.transform) {
     root->ToggleChild(*controller.transform, aVisible);
   }
@@ -345,6 +392,11 @@ namespace crow {
 struct BrowserWorld::State {
   BrowserWorldWeakPtr self;
   std::vector<WidgetPtr> widgets;
+  // Widget handles are assigned sequentially, so they index dense tables.
+  std::vector<WidgetPtr> widgetsByHandle;
+  std::vector<int32_t> widgetSlots; // Index into widgets, or -1.
+  std::unordered_map<std::string, WidgetPtr> widgetsBySurface;
+  WidgetBVHPtr widgetBVH;
   SurfaceObserverPtr surfaceObserver;
   DeviceDelegatePtr device;
   bool paused;
@@ -357,7 +409,25 @@ struct BrowserWorld::State {
   LightPtr light;
   ControllerContainerPtr controllers;
   CullVisitorPtr cullVisitor;
+  // The draw list of root is only rebuilt when sceneDirty is set. Controllers
+  // move every frame, so they live under their own root and list.
   DrawableListPtr drawList;
+  bool sceneDirty;
+  // Children of root, in draw order: opaque geometry such as the floor, then
+  // the translucent widgets sorted back to front.
+  GroupPtr opaqueRoot;
+  GroupPtr widgetRoot;
+  std::vector<uint32_t> widgetOrder;
+  vrb::Vector sortPosition;
+  GroupPtr controllerRoot;
+  DrawableListPtr controllerDrawList;
+  FrustumPtr frustum;
+  HiddenAreaMaskPtr hiddenArea;
+  ResolutionGovernorPtr governor;
+  // The scale last passed to the device, 0 if it does not support scaling.
+  float renderScale;
+  int32_t widgetsTested;
+  int32_t widgetsCulled;
   CameraPtr leftCamera;
   CameraPtr rightCamera;
   float nearClip;
@@ -366,19 +436,26 @@ struct BrowserWorld::State {
   jobject activity;
   float displayDensity;
   jmethodID dispatchCreateWidgetMethod;
-  jmethodID handleMotionEventMethod;
-  jmethodID handleScrollEventMethod;
-  jmethodID handleAudioPoseMethod;
-  jmethodID handleGestureMethod;
+  jmethodID handleEventBatchMethod;
+  AudioPoseChannelPtr audioPose;
+  std::vector<EventRecord> events;
+  int32_t eventCount;
+  jobject eventBuffer;
+  int64_t inputTime;
   GestureDelegateConstPtr gestures;
   bool windowsInitialized;
+  FrameTimingsPtr timings;
+  FrameHistogramPtr histogram;
+  FrameSchedulerPtr scheduler;
+  int64_t lastFrameStart;
+  InputRecorderPtr recorder;
 
   State() : paused(true), glInitialized(false), env(nullptr), nearClip(0.1f),
-            farClip(100.0f), activity(nullptr),
-            dispatchCreateWidgetMethod(nullptr), handleMotionEventMethod(nullptr),
-            handleScrollEventMethod(nullptr), handleAudioPoseMethod(nullptr),
-            handleGestureMethod(nullptr),
-            windowsInitialized(false) {
+            farClip(100.0f), activity(nullptr), displayDensity(1.0f),
+            dispatchCreateWidgetMethod(nullptr), handleEventBatchMethod(nullptr),
+            eventCount(0), eventBuffer(nullptr), inputTime(0),
+            windowsInitialized(false), lastFrameStart(0), sceneDirty(true),
+            widgetsTested(0), widgetsCulled(0), renderScale(0.0f) {
     context = Context::Create();
     contextWeak = context;
     factory = NodeFactoryObj::Create(contextWeak);
@@ -387,17 +464,41 @@ struct BrowserWorld::State {
     root = Group::Create(contextWeak);
     light = Light::Create(contextWeak);
     root->AddLight(light);
+    opaqueRoot = Group::Create(contextWeak);
+    root->AddNode(opaqueRoot);
+    widgetRoot = Group::Create(contextWeak);
+    root->AddNode(widgetRoot);
     cullVisitor = CullVisitor::Create(contextWeak);
     drawList = DrawableList::Create(contextWeak);
+    controllerRoot = Group::Create(contextWeak);
+    controllerRoot->AddLight(light);
+    controllerDrawList = DrawableList::Create(contextWeak);
+    frustum = Frustum::Create();
+    hiddenArea = HiddenAreaMask::Create();
+    governor = ResolutionGovernor::Create();
     controllers = ControllerContainer::Create();
     controllers->context = contextWeak;
     controllers->root = Toggle::Create(contextWeak);
+    timings = FrameTimings::Create();
+    histogram = FrameHistogram::Create();
+    scheduler = FrameScheduler::Create();
+    widgetBVH = WidgetBVH::Create();
+    events.resize(kEventCapacity);
+    audioPose = AudioPoseChannel::Create();
   }
 
   void InitializeWindows();
   void UpdateControllers();
+  void CullWidgets();
+  // Returns true if the draw order changed.
+  bool SortWidgets(const vrb::Vector& aHeadPosition);
+  void PushEvent(const int32_t aType, const int32_t aHandle, const int32_t aDevice, const int32_t aValue,
+                 const float aX, const float aY);
+  void FlushEvents();
+  void AddWidget(const WidgetPtr& aWidget);
+  void RemoveWidget(const WidgetPtr& aWidget);
   WidgetPtr GetWidget(int32_t aHandle) const;
-  WidgetPtr FindWidget(const std::function<bool(const WidgetPtr&)>& aCondition) const;
+  WidgetPtr GetWidget(const std::string& aSurfaceName) const;
 };
 
 void
@@ -407,20 +508,21 @@ BrowserWorld::State::InitializeWindows() {
   }
   WidgetPtr browser = Widget::Create(contextWeak, WidgetTypeBrowser);
   browser->SetTransform(Matrix::Position(Vector(0.0f, -3.0f, -18.0f)));
-  root->AddNode(browser->GetRoot());
-  widgets.push_back(std::move(browser));
+  widgetRoot->AddNode(browser->GetRoot());
+  AddWidget(browser);
 
   WidgetPtr urlbar = Widget::Create(contextWeak, WidgetTypeURLBar,
                                     (int32_t) (720.0f * displayDensity),
                                     (int32_t) (103.0f * displayDensity), 720.0f * kWorldDPIRatio);
   urlbar->SetTransform(Matrix::Position(Vector(0.0f, 7.15f, -18.0f)));
-  root->AddNode(urlbar->GetRoot());
-  widgets.push_back(std::move(urlbar));
+  widgetRoot->AddNode(urlbar->GetRoot());
+  AddWidget(urlbar);
   windowsInitialized = true;
 }
 
 void
 BrowserWorld::State::UpdateControllers() {
+  CROW_TRACE_SCOPE("BrowserWorld::UpdateControllers");
   std::vector<Widget*> active;
   for (Controller& controller: controllers->list) {
     if (!controller.enabled || (controller.index < 0)) {
@@ -428,24 +530,12 @@ BrowserWorld::State::UpdateControllers() {
     }
     vrb::Vector start = controller.transformMatrix.MultiplyPosition(vrb::Vector());
     vrb::Vector direction = controller.transformMatrix.MultiplyDirection(vrb::Vector(0.0f, 0.0f, -1.0f));
-    WidgetPtr hitWidget;
     float hitDistance = farClip;
     vrb::Vector hitPoint;
-    for (const WidgetPtr& widget: widgets) {
-      widget->TogglePointer(false);
-      vrb::Vector result;
-      float distance = 0.0f;
-      bool isInWidget = false;
-      if (widget->TestControllerIntersection(start, direction, result, isInWidget, distance)) {
-        if (isInWidget && (distance < hitDistance)) {
-          hitWidget = widget;
-          hitDistance = distance;
-          hitPoint = result;
-        }
-      }
-    }
-    if (handleMotionEventMethod && hitWidget) {
+    WidgetPtr hitWidget = widgetBVH->RayQuery(start, direction, farClip, hitPoint, hitDistance);
+    if (handleEventBatchMethod && hitWidget) {
       active.push_back(hitWidget.get());
+      hitWidget->SetPointerLocation(hitPoint);
       float theX = 0.0f, theY = 0.0f;
       hitWidget->ConvertToWidgetCoordinates(hitPoint, theX, theY);
       const uint32_t handle = hitWidget->GetHandle();
@@ -457,15 +547,14 @@ BrowserWorld::State::UpdateControllers() {
           (controller.pointerY != theY) ||
           (controller.widget != handle) ||
           (pressed != wasPressed)) {
-        env->CallVoidMethod(activity, handleMotionEventMethod, handle, controller.index,
-                            pressed, theX, theY);
+        PushEvent(EventMotion, handle, controller.index, pressed ? 1 : 0, theX, theY);
         controller.widget = handle;
         controller.pointerX = theX;
         controller.pointerY = theY;
       }
       if ((controller.scrollDeltaX != 0.0f) || controller.scrollDeltaY != 0.0f) {
-        env->CallVoidMethod(activity, handleScrollEventMethod, controller.widget, controller.index,
-                            controller.scrollDeltaX, controller.scrollDeltaY);
+        PushEvent(EventScroll, controller.widget, controller.index, 0, controller.scrollDeltaX,
+                  controller.scrollDeltaY);
         controller.scrollDeltaX = 0.0f;
         controller.scrollDeltaY = 0.0f;
       }
@@ -474,10 +563,9 @@ BrowserWorld::State::UpdateControllers() {
           if (!controller.wasTouched) {
             controller.wasTouched = controller.touched;
           } else {
-            env->CallVoidMethod(activity, handleScrollEventMethod, controller.widget,
-                                controller.index,
-                                (controller.touchX - controller.lastTouchX) * kScrollFactor,
-                                (controller.touchY - controller.lastTouchY) * kScrollFactor);
+            PushEvent(EventScroll, controller.widget, controller.index, 0,
+                      (controller.touchX - controller.lastTouchX) * kScrollFactor,
+                      (controller.touchY - controller.lastTouchY) * kScrollFactor);
           }
           controller.lastTouchX = controller.touchX;
           controller.lastTouchY = controller.touchY;
@@ -489,8 +577,9 @@ BrowserWorld::State::UpdateControllers() {
     }
     controller.lastButtonState = controller.buttonState;
   }
-  for (Widget* widget: active) {
-    widget->TogglePointer(true);
+  for (const WidgetPtr& widget: widgets) {
+    const bool pointed = std::find(active.begin(), active.end(), widget.get()) != active.end();
+    widget->TogglePointer(pointed);
   }
   active.clear();
   if (gestures) {
@@ -503,28 +592,152 @@ BrowserWorld::State::UpdateControllers() {
       } else if (type == GestureType::SwipeRight) {
         javaType = GestureSwipeRight;
       }
-      if (javaType >= 0 &&handleGestureMethod) {
-        env->CallVoidMethod(activity, handleGestureMethod, javaType);
+      if (javaType >= 0 && handleEventBatchMethod) {
+        PushEvent(EventGesture, -1, -1, javaType, 0.0f, 0.0f);
       }
     }
   }
+  FlushEvents();
+}
+
+void
+BrowserWorld::State::PushEvent(const int32_t aType, const int32_t aHandle, const int32_t aDevice,
+                               const int32_t aValue, const float aX, const float aY) {
+  if (eventCount >= kEventCapacity) {
+    VRB_LOG("Dropping input event %d, the event buffer is full", aType);
+    return;
+  }
+  EventRecord& record = events[eventCount++];
+  record.type = aType;
+  record.handle = aHandle;
+  record.device = aDevice;
+  record.value = aValue;
+  record.x = aX;
+  record.y = aY;
+  record.time = inputTime;
+}
+
+void
+BrowserWorld::State::FlushEvents() {
+  if ((eventCount > 0) && handleEventBatchMethod && eventBuffer) {
+    env->CallVoidMethod(activity, handleEventBatchMethod, eventBuffer, eventCount);
+  }
+  eventCount = 0;
+}
+
+// Hides the widgets outside both eye frusta. The cameras still hold last
+// frame's pose at this point, which the frustum margin covers.
+void
+BrowserWorld::State::CullWidgets() {
+  CROW_TRACE_SCOPE("BrowserWorld::CullWidgets");
+  const bool valid = leftCamera && rightCamera && frustum->Set(*leftCamera, *rightCamera);
+  widgetsTested = 0;
+  widgetsCulled = 0;
+  for (const WidgetPtr& widget: widgets) {
+    bool inView = true;
+    if (valid && widget->IsVisible()) {
+      vrb::Vector min, max;
+      widget->GetWorldBounds(min, max);
+      inView = frustum->IsVisible(min, max);
+      widgetsTested++;
+      widgetsCulled += inView ? 0 : 1;
+    }
+    if (widget->SetInView(inView)) {
+      sceneDirty = true;
+    }
+  }
+  CROW_TRACE_COUNTER("WidgetsCulled", widgetsCulled);
+}
+
+// Widgets are blended, so they are drawn furthest first. The children of
+// widgetRoot are only reordered when the order actually changes.
+bool
+BrowserWorld::State::SortWidgets(const vrb::Vector& aHeadPosition) {
+  CROW_TRACE_SCOPE("BrowserWorld::SortWidgets");
+  sortPosition = aHeadPosition;
+  std::vector<std::pair<float, Widget*>> sorted;
+  sorted.reserve(widgets.size());
+  for (const WidgetPtr& widget: widgets) {
+    vrb::Vector min, max;
+    widget->GetWorldBounds(min, max);
+    const vrb::Vector offset = ((min + max) * 0.5f) - aHeadPosition;
+    sorted.emplace_back(offset.Dot(offset), widget.get());
+  }
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const std::pair<float, Widget*>& aFirst, const std::pair<float, Widget*>& aSecond) {
+    return aFirst.first > aSecond.first;
+  });
+  bool changed = sorted.size() != widgetOrder.size();
+  for (size_t index = 0; !changed && (index < sorted.size()); index++) {
+    changed = sorted[index].second->GetHandle() != widgetOrder[index];
+  }
+  if (!changed) {
+    return false;
+  }
+  widgetOrder.clear();
+  for (const std::pair<float, Widget*>& entry: sorted) {
+    widgetRoot->RemoveNode(*entry.second->GetRoot());
+  }
+  for (const std::pair<float, Widget*>& entry: sorted) {
+    widgetRoot->AddNode(entry.second->GetRoot());
+    widgetOrder.push_back(entry.second->GetHandle());
+  }
+  CROW_TRACE_INSTANT("BrowserWorld::SortWidgets");
+  return true;
+}
+
+void
+BrowserWorld::State::AddWidget(const WidgetPtr& aWidget) {
+  const uint32_t handle = aWidget->GetHandle();
+  if (handle >= widgetsByHandle.size()) {
+    widgetsByHandle.resize(handle + 1);
+    widgetSlots.resize(handle + 1, -1);
+  }
+  widgetsByHandle[handle] = aWidget;
+  widgetsBySurface[aWidget->GetSurfaceTextureName()] = aWidget;
+  widgetSlots[handle] = (int32_t)widgets.size();
+  widgets.push_back(aWidget);
+  widgetBVH->AddWidget(aWidget);
+  // Pointers sit under controllerRoot, which is culled every frame, so hand
+  // jitter moving them does not dirty the scene.
+  controllerRoot->AddNode(aWidget->GetPointerRoot());
+  sceneDirty = true;
+}
+
+void
+BrowserWorld::State::RemoveWidget(const WidgetPtr& aWidget) {
+  widgetBVH->RemoveWidget(aWidget);
+  aWidget->GetPointerRoot()->RemoveFromParents();
+  widgetsBySurface.erase(aWidget->GetSurfaceTextureName());
+  const uint32_t handle = aWidget->GetHandle();
+  widgetsByHandle[handle] = nullptr;
+  // The order of the list does not matter, so move the last entry into the
+  // removed widget's slot rather than shifting the ones after it.
+  const int32_t slot = widgetSlots[handle];
+  if (slot >= 0) {
+    widgets[slot] = widgets.back();
+    widgetSlots[widgets[slot]->GetHandle()] = slot;
+    widgets.pop_back();
+    widgetSlots[handle] = -1;
+  }
+  sceneDirty = true;
 }
 
 WidgetPtr
 BrowserWorld::State::GetWidget(int32_t aHandle) const {
-  return FindWidget([=](const WidgetPtr& aWidget){
-    return aWidget->GetHandle() == aHandle;
-  });
+  if ((aHandle < 0) || ((size_t)aHandle >= widgetsByHandle.size())) {
+    return {};
+  }
+  return widgetsByHandle[aHandle];
 }
 
 WidgetPtr
-BrowserWorld::State::FindWidget(const std::function<bool(const WidgetPtr&)>& aCondition) const {
-  for (const WidgetPtr & widget: widgets) {
-    if (aCondition(widget)) {
-      return widget;
-    }
+BrowserWorld::State::GetWidget(const std::string& aSurfaceName) const {
+  auto it = widgetsBySurface.find(aSurfaceName);
+  if (it == widgetsBySurface.end()) {
+    return {};
   }
-  return {};
+  return it->second;
 }
 
 BrowserWorldPtr
@@ -550,9 +763,19 @@ BrowserWorld::RegisterDeviceDelegate(DeviceDelegatePtr aDelegate) {
     m.leftCamera = m.device->GetCamera(DeviceDelegate::CameraEnum::Left);
     m.rightCamera = m.device->GetCamera(DeviceDelegate::CameraEnum::Right);
     ControllerDelegatePtr delegate = m.controllers;
+    if (m.recorder) {
+      delegate = m.recorder;
+    }
     m.device->SetClipPlanes(m.nearClip, m.farClip);
     m.device->SetControllerDelegate(delegate);
     m.gestures = m.device->GetGestureDelegate();
+    std::vector<float> mesh;
+    for (DeviceDelegate::CameraEnum eye: {DeviceDelegate::CameraEnum::Left, DeviceDelegate::CameraEnum::Right}) {
+      if (m.device->GetHiddenAreaMesh(eye, mesh)) {
+        m.hiddenArea->SetMesh(eye, mesh);
+      }
+    }
+    m.renderScale = m.device->SetRenderScale(m.governor->GetScale()) ? m.governor->GetScale() : 0.0f;
   } else if (previousDevice) {
     m.leftCamera = m.rightCamera = nullptr;
     for (Controller& controller: m.controllers->list) {
@@ -570,11 +793,15 @@ BrowserWorld::RegisterDeviceDelegate(DeviceDelegatePtr aDelegate) {
 void
 BrowserWorld::Pause() {
   m.paused = true;
+  CROW_TRACE_INSTANT("BrowserWorld::Pause");
 }
 
 void
 BrowserWorld::Resume() {
   m.paused = false;
+  // Do not count the time spent paused as a frame.
+  m.lastFrameStart = 0;
+  CROW_TRACE_INSTANT("BrowserWorld::Resume");
 }
 
 bool
@@ -607,35 +834,37 @@ BrowserWorld::InitializeJava(JNIEnv* aEnv, jobject& aActivity, jobject& aAssetMa
     VRB_LOG("Failed to find Java method: %s %s", kDispatchCreateWidgetName, kDispatchCreateWidgetSignature);
   }
 
-  m.handleMotionEventMethod = m.env->GetMethodID(clazz, kHandleMotionEventName, kHandleMotionEventSignature);
+  m.handleEventBatchMethod = m.env->GetMethodID(clazz, kHandleEventBatchName, kHandleEventBatchSignature);
 
-  if (!m.handleMotionEventMethod) {
-    VRB_LOG("Failed to find Java method: %s %s", kHandleMotionEventName, kHandleMotionEventSignature);
+  if (!m.handleEventBatchMethod) {
+    VRB_LOG("Failed to find Java method: %s %s", kHandleEventBatchName, kHandleEventBatchSignature);
   }
 
-  m.handleScrollEventMethod = m.env->GetMethodID(clazz, kHandleScrollEvent, kHandleScrollEventSignature);
-
-  if (!m.handleScrollEventMethod) {
-    VRB_LOG("Failed to find Java method: %s %s", kHandleScrollEvent, kHandleScrollEventSignature)
-  }
-
-  m.handleAudioPoseMethod =  m.env->GetMethodID(clazz, kHandleAudioPoseName, kHandleAudioPoseSignature);
-
-  if (!m.handleAudioPoseMethod) {
-    VRB_LOG("Failed to find Java method: %s %s", kHandleAudioPoseName, kHandleAudioPoseSignature);
+  jobject eventBuffer = m.env->NewDirectByteBuffer(m.events.data(), m.events.size() * sizeof(EventRecord));
+  if (eventBuffer) {
+    m.eventBuffer = m.env->NewGlobalRef(eventBuffer);
+    m.env->DeleteLocalRef(eventBuffer);
   }
 
-  m.handleGestureMethod = m.env->GetMethodID(clazz, kHandleGestureName, kHandleGestureSignature);
-
-  if (!m.handleGestureMethod) {
-    VRB_LOG("Failed to find Java method: %s %s", kHandleGestureName, kHandleGestureSignature);
-  }
+  WidgetPlacement::InitializeJava(m.env, m.activity);
 
   jmethodID getDisplayDensityMethod =  m.env->GetMethodID(clazz, kGetDisplayDensityName, kGetDisplayDensitySignature);
   if (getDisplayDensityMethod) {
     m.displayDensity = m.env->CallFloatMethod(m.activity, getDisplayDensityMethod);
   }
 
+  InitializeScene();
+}
+
+void
+BrowserWorld::InitializeHeadless(const float aDisplayDensity) {
+  VRB_LOG("BrowserWorld::InitializeHeadless");
+  m.displayDensity = aDisplayDensity;
+  InitializeScene();
+}
+
+void
+BrowserWorld::InitializeScene() {
   m.InitializeWindows();
 
   if (!m.controllers->modelsLoaded) {
@@ -644,11 +873,17 @@ BrowserWorld::InitializeJava(JNIEnv* aEnv, jobject& aActivity, jobject& aAssetMa
       const std::string fileName = m.device->GetControllerModelName(index);
       if (!fileName.empty()) {
         m.controllers->SetUpModelsGroup(index);
-        m.factory->SetModelRoot(m.controllers->models[index]);
-        m.parser->LoadModel(fileName);
+        // Parsing a model takes several frames worth of time, so each one is
+        // left to the scheduler, which runs it once it fits in the slack after
+        // a frame or has waited too long.
+        m.scheduler->Post(FrameScheduler::Priority::Low, "ParserObj::LoadModel", kModelLoadEstimate, [=]() {
+          m.factory->SetModelRoot(m.controllers->models[index]);
+          CROW_TRACE_SCOPE("ParserObj::LoadModel");
+          m.parser->LoadModel(fileName);
+        });
       }
     }
-    m.root->AddNode(m.controllers->root);
+    m.controllerRoot->AddNode(m.controllers->root);
     CreateControllerPointer();
     CreateFloor();
     m.controllers->modelsLoaded = true;
@@ -658,14 +893,19 @@ BrowserWorld::InitializeJava(JNIEnv* aEnv, jobject& aActivity, jobject& aAssetMa
 void
 BrowserWorld::InitializeGL() {
   VRB_LOG("BrowserWorld::InitializeGL");
+  Trace::SetThreadName("Render");
   if (m.context) {
     if (!m.glInitialized) {
+      // The context may be new, for example after GLSurfaceView recreated it
+      // on resume, so nothing the cache remembers can be trusted.
+      GLStateCache::Invalidate();
       m.glInitialized = m.context->InitializeGL();
-      VRB_GL_CHECK(glEnable(GL_BLEND));
-      VRB_GL_CHECK(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+      GLStateCache::Enable(GL_BLEND);
+      GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
       if (!m.glInitialized) {
         return;
       }
+      m.hiddenArea->InitializeGL();
       SurfaceTextureFactoryPtr factory = m.context->GetSurfaceTextureFactory();
       for (WidgetPtr& widget: m.widgets) {
         const std::string name = widget->GetSurfaceTextureName();
@@ -683,13 +923,16 @@ BrowserWorld::ShutdownJava() {
   VRB_LOG("BrowserWorld::ShutdownJava");
   if (m.env) {
     m.env->DeleteGlobalRef(m.activity);
+    if (m.eventBuffer) {
+      m.env->DeleteGlobalRef(m.eventBuffer);
+    }
   }
   m.activity = nullptr;
+  m.eventBuffer = nullptr;
+  m.eventCount = 0;
   m.dispatchCreateWidgetMethod = nullptr;
-  m.handleMotionEventMethod = nullptr;
-  m.handleScrollEventMethod = nullptr;
-  m.handleAudioPoseMethod = nullptr;
-  m.handleGestureMethod = nullptr;
+  m.handleEventBatchMethod = nullptr;
+  WidgetPlacement::ShutdownJava();
   m.env = nullptr;
 }
 
@@ -699,6 +942,7 @@ BrowserWorld::ShutdownGL() {
   if (m.context) {
     m.context->ShutdownGL();
   }
+  m.hiddenArea->ShutdownGL();
   m.glInitialized = false;
 }
 
@@ -713,44 +957,106 @@ BrowserWorld::Draw() {
     return;
   }
   if (!m.glInitialized) {
+    GLStateCache::Invalidate();
     m.glInitialized = m.context->InitializeGL();
     if (!m.glInitialized) {
       VRB_LOG("FAILED to initialize GL");
       return;
     }
   }
+  const int64_t frameStart = FrameTimings::Now();
+  const int64_t frameInterval = m.lastFrameStart > 0 ? frameStart - m.lastFrameStart : 0;
+  if (frameInterval > 0) {
+    m.histogram->AddSample(frameInterval, m.device->GetDisplayPeriod());
+    CROW_TRACE_COUNTER("FrameInterval", (double)frameInterval / 1000000.0);
+  }
+  m.lastFrameStart = frameStart;
+  m.scheduler->StartFrame(frameStart, m.device->GetDisplayPeriod());
+  CROW_TRACE_SCOPE("BrowserWorld::Draw");
+  m.timings->StartFrame();
   m.device->ProcessEvents();
+  m.inputTime = FrameTimings::Now();
+  if (m.recorder) {
+    m.recorder->RecordFrame(m.device->GetHeadTransform());
+  }
+  m.timings->EndPhase(FrameTimings::Phase::ProcessEvents);
   m.context->Update();
+  m.timings->EndPhase(FrameTimings::Phase::ContextUpdate);
   m.UpdateControllers();
-  m.drawList->Reset();
-  m.root->Cull(*m.cullVisitor, *m.drawList);
+  m.timings->EndPhase(FrameTimings::Phase::UpdateControllers);
+  {
+    CROW_TRACE_SCOPE("BrowserWorld::Cull");
+    m.CullWidgets();
+    const vrb::Vector headPosition = m.device->GetHeadTransform().GetTranslation();
+    const vrb::Vector moved = headPosition - m.sortPosition;
+    if (m.sceneDirty || (moved.Dot(moved) > (kResortDistance * kResortDistance))) {
+      if (m.SortWidgets(headPosition)) {
+        m.sceneDirty = true;
+      }
+    }
+    if (m.sceneDirty) {
+      m.drawList->Reset();
+      m.root->Cull(*m.cullVisitor, *m.drawList);
+      m.sceneDirty = false;
+      CROW_TRACE_INSTANT("BrowserWorld::CullScene");
+    }
+    m.controllerDrawList->Reset();
+    m.controllerRoot->Cull(*m.cullVisitor, *m.controllerDrawList);
+  }
+  m.timings->EndPhase(FrameTimings::Phase::Cull);
   m.device->StartFrame();
+  m.timings->EndPhase(FrameTimings::Phase::StartFrame);
   m.device->BindEye(DeviceDelegate::CameraEnum::Left);
+  m.hiddenArea->Draw(DeviceDelegate::CameraEnum::Left);
   m.drawList->Draw(*m.leftCamera);
+  m.controllerDrawList->Draw(*m.leftCamera);
+  m.timings->EndPhase(FrameTimings::Phase::DrawLeft);
   // When running the noapi flavor, we only want to render one eye.
 #if !defined(VRBROWSER_NO_VR_API)
   m.device->BindEye(DeviceDelegate::CameraEnum::Right);
+  m.hiddenArea->Draw(DeviceDelegate::CameraEnum::Right);
   m.drawList->Draw(*m.rightCamera);
+  m.controllerDrawList->Draw(*m.rightCamera);
+  m.timings->EndPhase(FrameTimings::Phase::DrawRight);
 #endif // !defined(VRBROWSER_NO_VR_API)
+  // Taken before EndFrame, whose submit may block until vsync or until the
+  // GPU catches up and would make every frame look fully loaded.
+  const int64_t cpuTime = FrameTimings::Now() - frameStart;
   m.device->EndFrame();
-
-  // Update the 3d audio engine with the most recent head rotation.
-  if (m.handleAudioPoseMethod) {
-    const vrb::Matrix &head = m.device->GetHeadTransform();
-    const vrb::Vector p = head.GetTranslation();
-    const vrb::Quaternion q(head);
-    m.env->CallVoidMethod(m.activity, m.handleAudioPoseMethod, q.x(), q.y(), q.z(), q.w(), p.x(), p.y(), p.z());
+  m.timings->EndPhase(FrameTimings::Phase::EndFrame);
+  if (Trace::IsEnabled()) {
+    GLStateCache::Counters counters;
+    GLStateCache::GetCounters(counters);
+    Trace::Counter("GLStateIssued", counters.issued);
+    Trace::Counter("GLStateElided", counters.elided);
+    Trace::Counter("HiddenAreaPixels", (double)m.hiddenArea->GetMaskedPixels());
+    Trace::Counter("EyeBufferBytesAvoided", (double)EyeBufferHints::GetBytesAvoided());
+  }
+
+  // Publish the most recent head pose for the 3d audio engine, which reads it
+  // at its own rate.
+  m.audioPose->Publish(m.device->GetHeadTransform());
+  m.timings->EndPhase(FrameTimings::Phase::AudioPose);
+  m.timings->EndFrame();
+
+  if (m.renderScale > 0.0f) {
+    m.governor->Update(cpuTime, frameInterval, m.device->GetDisplayPeriod());
+    if (m.governor->GetScale() != m.renderScale) {
+      m.renderScale = m.governor->GetScale();
+      m.device->SetRenderScale(m.renderScale);
+    }
   }
 
+  // Deferred work only runs in the time left before the next frame is due.
+  m.scheduler->EndFrame(FrameTimings::Now(), m.device->GetPredictedDisplayTime());
+  m.scheduler->RunSlack();
 }
 
 void
 BrowserWorld::SetSurfaceTexture(const std::string& aName, jobject& aSurface) {
   VRB_LOG("SetSurfaceTexture: %s", aName.c_str());
   if (m.env && m.activity && m.dispatchCreateWidgetMethod) {
-    WidgetPtr widget = m.FindWidget([=](const WidgetPtr& aWidget) -> bool {
-      return aName == aWidget->GetSurfaceTextureName();
-    });
+    WidgetPtr widget = m.GetWidget(aName);
     if (widget) {
       int32_t width = 0, height = 0;
       widget->GetSurfaceTextureSize(width, height);
@@ -777,8 +1083,8 @@ BrowserWorld::AddWidget(const WidgetPlacement& aPlacement, bool aVisible, int32_
                                     (int32_t)(aPlacement.height * m.displayDensity),
                                     worldWidth);
   widget->SetAddCallbackId(aCallbackId);
-  m.root->AddNode(widget->GetRoot());
-  m.widgets.push_back(widget);
+  m.widgetRoot->AddNode(widget->GetRoot());
+  m.AddWidget(widget);
   widget->ToggleWidget(aVisible);
   TransformWidget(widget->GetHandle(), aPlacement);
 }
@@ -797,33 +1103,16 @@ BrowserWorld::TransformWidget(int32_t aHandle, const WidgetPlacement& aPlacement
     return;
   }
 
-  int32_t parentWidth, parentHeight;
-  float parentWorldWith, parentWorldHeight;
-  parent->GetSurfaceTextureSize(parentWidth, parentHeight);
-  parent->GetWorldSize(parentWorldWith, parentWorldHeight);
+  float parentWorldWidth, parentWorldHeight;
+  parent->GetWorldSize(parentWorldWidth, parentWorldHeight);
 
   float worldWidth, worldHeight;
   widget->GetWorldSize(worldWidth, worldHeight);
 
-  vrb::Matrix transform = vrb::Matrix::Identity();
-  if (aPlacement.rotation != 0.0) {
-    transform = vrb::Matrix::Rotation(aPlacement.rotationAxis, aPlacement.rotation);
-  }
-
-  vrb::Vector translation = vrb::Vector(aPlacement.translation.x() * kWorldDPIRatio,
-                                        aPlacement.translation.y() * kWorldDPIRatio,
-                                        aPlacement.translation.z() * kWorldDPIRatio);
-  // Widget anchor point
-  translation -= vrb::Vector((aPlacement.anchor.x() - 0.5f) * worldWidth,
-                             aPlacement.anchor.y() * worldHeight,
-                             0.0f);
-  // Parent anchor point
-  translation += vrb::Vector(parentWorldWith * aPlacement.parentAnchor.x() - parentWorldWith * 0.5f,
-                             parentWorldHeight * aPlacement.parentAnchor.y(),
-                             0.0f);
-
-  transform.TranslateInPlace(translation);
-  widget->SetTransform(parent->GetTransform().PostMultiply(transform));
+  widget->SetTransform(aPlacement.GetTransform(parent->GetTransform(), parentWorldWidth, parentWorldHeight,
+                                               worldWidth, worldHeight));
+  m.widgetBVH->UpdateWidget(widget);
+  m.sceneDirty = true;
   // Fixme: Remove this once we have proper scaling of the pointer
   if (aPlacement.worldScale != 1.0f) {
     VRB_LOG("Baina nor da %f", aPlacement.worldScale);
@@ -837,6 +1126,7 @@ BrowserWorld::SetWidgetVisible(int32_t aHandle, bool aVisible) {
   WidgetPtr widget = m.GetWidget(aHandle);
   if (widget) {
     widget->ToggleWidget(aVisible);
+    m.sceneDirty = true;
   }
 }
 
@@ -845,11 +1135,111 @@ BrowserWorld::RemoveWidget(int32_t aHandle) {
   WidgetPtr widget = m.GetWidget(aHandle);
   if (widget) {
     widget->GetRoot()->RemoveFromParents();
-    auto it = std::find(m.widgets.begin(), m.widgets.end(), widget);
-    if (it != m.widgets.end()) {
-      m.widgets.erase(it);
+    m.RemoveWidget(widget);
+  }
+}
+
+bool
+BrowserWorld::StartInputRecording(const std::string& aPath) {
+  StopInputRecording();
+  InputRecorderPtr recorder = InputRecorder::Create(m.controllers);
+  if (!recorder->Open(aPath)) {
+    return false;
+  }
+  // Capture the controllers that already exist so the replay starts from the same state.
+  static const int32_t kButtons[] = {
+    ControllerDelegate::BUTTON_TRIGGER, ControllerDelegate::BUTTON_TOUCHPAD, ControllerDelegate::BUTTON_MENU
+  };
+  for (const Controller& controller: m.controllers->list) {
+    if (controller.index < 0) {
+      continue;
+    }
+    recorder->CreateController(controller.index, controller.modelIndex);
+    recorder->SetEnabled(controller.index, controller.enabled);
+    recorder->SetVisible(controller.index, controller.visible);
+    recorder->SetTransform(controller.index, controller.transformMatrix);
+    for (const int32_t button: kButtons) {
+      recorder->SetButtonState(controller.index, button, (controller.buttonState & button) != 0);
+    }
+    if (controller.touched) {
+      recorder->SetTouchPosition(controller.index, controller.touchX, controller.touchY);
+    } else {
+      recorder->EndTouch(controller.index);
     }
   }
+  m.recorder = recorder;
+  if (m.device) {
+    ControllerDelegatePtr delegate = m.recorder;
+    m.device->SetControllerDelegate(delegate);
+  }
+  return true;
+}
+
+void
+BrowserWorld::StopInputRecording() {
+  if (!m.recorder) {
+    return;
+  }
+  m.recorder->Close();
+  m.recorder = nullptr;
+  if (m.device) {
+    ControllerDelegatePtr delegate = m.controllers;
+    m.device->SetControllerDelegate(delegate);
+  }
+}
+
+void
+BrowserWorld::SetAudioPoseThreshold(const float aRotation, const float aDistance) {
+  m.audioPose->SetThreshold(aRotation, aDistance);
+}
+
+int32_t
+BrowserWorld::ReadAudioPose(float* aPose) const {
+  return m.audioPose->Read(aPose);
+}
+
+FrameTimingsPtr
+BrowserWorld::GetFrameTimings() const {
+  return m.timings;
+}
+
+FrameHistogramPtr
+BrowserWorld::GetFrameHistogram() const {
+  return m.histogram;
+}
+
+FrameSchedulerPtr
+BrowserWorld::GetScheduler() const {
+  return m.scheduler;
+}
+
+int64_t
+BrowserWorld::GetRunnableBudget() const {
+  if (m.paused || !m.device) {
+    return RunnableQueue::kNoBudget;
+  }
+  int64_t result = (int64_t)(m.device->GetDisplayPeriod() * kRunnableBudget * 1.0e9f);
+  int64_t slack = 0;
+  if (m.scheduler->GetSlack(FrameTimings::Now(), slack)) {
+    result = std::max((int64_t)0, std::min(result, slack));
+  }
+  return result;
+}
+
+void
+BrowserWorld::GetCullStats(int32_t& aTested, int32_t& aCulled) const {
+  aTested = m.widgetsTested;
+  aCulled = m.widgetsCulled;
+}
+
+HiddenAreaMaskPtr
+BrowserWorld::GetHiddenAreaMask() const {
+  return m.hiddenArea;
+}
+
+ResolutionGovernorPtr
+BrowserWorld::GetResolutionGovernor() const {
+  return m.governor;
 }
 
 JNIEnv*
@@ -887,7 +1277,11 @@ BrowserWorld::CreateFloor() {
   array->AppendNormal(kNormal);
 
   RenderStatePtr state = RenderState::Create(m.contextWeak);
-  TexturePtr tile = m.context->GetTextureCache()->LoadTexture(kTileTexture);
+  TexturePtr tile;
+  {
+    CROW_TRACE_SCOPE("TextureCache::LoadTexture");
+    tile = m.context->GetTextureCache()->LoadTexture(kTileTexture);
+  }
   if (tile) {
     tile->SetTextureParameter(GL_TEXTURE_WRAP_S, GL_REPEAT);
     tile->SetTextureParameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -911,7 +1305,8 @@ BrowserWorld::CreateFloor() {
   normalIndex.push_back(1);
   geometry->AddFace(index, index, normalIndex);
 
-  m.root->AddNode(geometry);
+  m.opaqueRoot->AddNode(geometry);
+  m.sceneDirty = true;
 }
 
 void
@@ -984,13 +1379,21 @@ BrowserWorld::CreateControllerPointer() {
   JNIEXPORT return_type JNICALL              \
     Java_org_mozilla_vrbrowser_VRBrowserActivity_##method_name
 
+// Placements are decoded into one reused instance instead of allocating per
+// call. JNI entry points only run on the render thread.
+static crow::WidgetPlacement&
+GetPooledPlacement() {
+  static crow::WidgetPlacementPtr sPlacement = crow::WidgetPlacement::Create();
+  return *sPlacement;
+}
+
 extern "C" {
 
 JNI_METHOD(void, addWidgetNative)
-(JNIEnv*, jobject, jobject aPlacement, jboolean aVisible, jint aCallbackId) {
-  crow::WidgetPlacementPtr placement = crow::WidgetPlacement::FromJava(sWorld->GetJNIEnv(), aPlacement);
-  if (placement && sWorld) {
-    sWorld->AddWidget(*placement, aVisible, aCallbackId);
+(JNIEnv* aEnv, jobject, jobject aPlacement, jboolean aVisible, jint aCallbackId) {
+  crow::WidgetPlacement& placement = GetPooledPlacement();
+  if (sWorld && crow::WidgetPlacement::FromJava(aEnv, aPlacement, placement)) {
+    sWorld->AddWidget(placement, aVisible, aCallbackId);
   }
 }
 
@@ -1002,13 +1405,37 @@ JNI_METHOD(void, setWidgetVisibleNative)
 }
 
 JNI_METHOD(void, updateWidgetPlacementNative)
-(JNIEnv*, jobject, jint aHandle, jobject aPlacement) {
-  crow::WidgetPlacementPtr placement = crow::WidgetPlacement::FromJava(sWorld->GetJNIEnv(), aPlacement);
-  if (placement) {
-    sWorld->TransformWidget(aHandle, *placement);
+(JNIEnv* aEnv, jobject, jint aHandle, jobject aPlacement) {
+  crow::WidgetPlacement& placement = GetPooledPlacement();
+  if (sWorld && crow::WidgetPlacement::FromJava(aEnv, aPlacement, placement)) {
+    sWorld->TransformWidget(aHandle, placement);
   }
 }
 
+JNI_METHOD(void, updateWidgetPlacementsNative)
+(JNIEnv* aEnv, jobject, jintArray aHandles, jobjectArray aPlacements, jint aCount) {
+  if (!sWorld || !aHandles || !aPlacements) {
+    return;
+  }
+  const jsize count = std::min((jsize)aCount, std::min(aEnv->GetArrayLength(aHandles),
+                                                        aEnv->GetArrayLength(aPlacements)));
+  jint* handles = aEnv->GetIntArrayElements(aHandles, nullptr);
+  if (!handles) {
+    return;
+  }
+  crow::WidgetPlacement& placement = GetPooledPlacement();
+  // Applied in array order so parents placed earlier in the batch are already
+  // moved when their children are transformed.
+  for (jsize index = 0; index < count; index++) {
+    jobject object = aEnv->GetObjectArrayElement(aPlacements, index);
+    if (crow::WidgetPlacement::FromJava(aEnv, object, placement)) {
+      sWorld->TransformWidget(handles[index], placement);
+    }
+    aEnv->DeleteLocalRef(object);
+  }
+  aEnv->ReleaseIntArrayElements(aHandles, handles, JNI_ABORT);
+}
+
 JNI_METHOD(void, removeWidgetNative)
 (JNIEnv*, jobject, jint aHandle) {
   if (sWorld) {
@@ -1016,4 +1443,121 @@ JNI_METHOD(void, removeWidgetNative)
   }
 }
 
+JNI_METHOD(jint, getFrameTimingsNative)
+(JNIEnv* aEnv, jobject, jlongArray aBuffer) {
+  if (!sWorld || !aBuffer) {
+    return 0;
+  }
+  const jsize stride = crow::FrameTimings::kPhaseCount + 2;
+  const jsize maxRecords = aEnv->GetArrayLength(aBuffer) / stride;
+  std::vector<crow::FrameTimings::Record> records(maxRecords);
+  const jint count = sWorld->GetFrameTimings()->GetRecentRecords(records.data(), maxRecords);
+  std::vector<jlong> values(count * stride);
+  for (jint index = 0; index < count; index++) {
+    const crow::FrameTimings::Record& record = records[index];
+    jlong* out = &values[index * stride];
+    out[0] = (jlong)record.frame;
+    out[1] = (jlong)record.start;
+    for (int32_t phase = 0; phase < crow::FrameTimings::kPhaseCount; phase++) {
+      out[2 + phase] = (jlong)record.phases[phase];
+    }
+  }
+  if (count > 0) {
+    aEnv->SetLongArrayRegion(aBuffer, 0, count * stride, values.data());
+  }
+  return count;
+}
+
+JNI_METHOD(jboolean, dumpFrameTimingsNative)
+(JNIEnv* aEnv, jobject, jstring aPath) {
+  if (!sWorld || !aPath) {
+    return JNI_FALSE;
+  }
+  const char* path = aEnv->GetStringUTFChars(aPath, nullptr);
+  const bool result = sWorld->GetFrameTimings()->Dump(path);
+  aEnv->ReleaseStringUTFChars(aPath, path);
+  return (jboolean)result;
+}
+
+JNI_METHOD(void, getFrameStatsNative)
+(JNIEnv* aEnv, jobject, jdoubleArray aStats) {
+  if (!sWorld || !aStats || (aEnv->GetArrayLength(aStats) < crow::FrameHistogram::kSnapshotSize)) {
+    return;
+  }
+  crow::FrameHistogram::Snapshot snapshot;
+  sWorld->GetFrameHistogram()->GetSnapshot(snapshot);
+  aEnv->SetDoubleArrayRegion(aStats, 0, crow::FrameHistogram::kSnapshotSize, (const jdouble*)&snapshot);
+}
+
+JNI_METHOD(void, resetFrameStatsNative)
+(JNIEnv*, jobject) {
+  if (sWorld) {
+    sWorld->GetFrameHistogram()->Reset();
+  }
+}
+
+JNI_METHOD(void, setAudioPoseThresholdNative)
+(JNIEnv*, jobject, jfloat aRotation, jfloat aDistance) {
+  if (sWorld) {
+    sWorld->SetAudioPoseThreshold(aRotation, aDistance);
+  }
+}
+
+// Replaces any mesh the device supplied with one built from the lens radius.
+JNI_METHOD(void, setLensRadiusNative)
+(JNIEnv*, jobject, jfloat aRadius) {
+  if (sWorld) {
+    sWorld->GetHiddenAreaMask()->SetLensRadius(aRadius);
+  }
+}
+
+// Called from the Java main thread while the audio engine is resumed.
+JNI_METHOD(jint, readAudioPoseNative)
+(JNIEnv* aEnv, jobject, jfloatArray aPose) {
+  if (!sWorld || !aPose || (aEnv->GetArrayLength(aPose) < crow::AudioPoseChannel::kPoseSize)) {
+    return -1;
+  }
+  float pose[crow::AudioPoseChannel::kPoseSize];
+  const int32_t sequence = sWorld->ReadAudioPose(pose);
+  if (sequence >= 0) {
+    aEnv->SetFloatArrayRegion(aPose, 0, crow::AudioPoseChannel::kPoseSize, pose);
+  }
+  return sequence;
+}
+
+JNI_METHOD(jboolean, startInputRecordingNative)
+(JNIEnv* aEnv, jobject, jstring aPath) {
+  if (!sWorld || !aPath) {
+    return JNI_FALSE;
+  }
+  const char* path = aEnv->GetStringUTFChars(aPath, nullptr);
+  const bool result = sWorld->StartInputRecording(path);
+  aEnv->ReleaseStringUTFChars(aPath, path);
+  return (jboolean)result;
+}
+
+JNI_METHOD(void, stopInputRecordingNative)
+(JNIEnv*, jobject) {
+  if (sWorld) {
+    sWorld->StopInputRecording();
+  }
+}
+
+JNI_METHOD(void, startTracingNative)
+(JNIEnv*, jobject) {
+  crow::Trace::Start();
+}
+
+JNI_METHOD(jboolean, stopTracingNative)
+(JNIEnv* aEnv, jobject, jstring aPath) {
+  crow::Trace::Stop();
+  if (!aPath) {
+    return JNI_FALSE;
+  }
+  const char* path = aEnv->GetStringUTFChars(aPath, nullptr);
+  const bool result = crow::Trace::Write(path);
+  aEnv->ReleaseStringUTFChars(aPath, path);
+  return (jboolean)result;
+}
+
 } // extern "C"
@@ -10,9 +10,15 @@
 #include "vrb/MacroUtils.h"
 
 #include "DeviceDelegate.h"
+#include "FrameHistogram.h"
+#include "FrameScheduler.h"
+#include "FrameTimings.h"
+#include "HiddenAreaMask.h"
+#include "ResolutionGovernor.h"
 
 #include <jni.h>
 #include <memory>
+#include <string>
 
 namespace crow {
 
@@ -31,6 +37,7 @@ public:
   void Resume();
   bool IsPaused() const;
   void InitializeJava(JNIEnv* aEnv, jobject& aActivity, jobject& aAssetManager);
+  void InitializeHeadless(const float aDisplayDensity);
   void InitializeGL();
   void ShutdownJava();
   void ShutdownGL();
@@ -40,11 +47,28 @@ public:
   void SetWidgetVisible(int32_t aHandle, bool aVisible);
   void TransformWidget(int32_t aHandle, const WidgetPlacement& aPlacement);
   void RemoveWidget(int32_t aHandle);
+  bool StartInputRecording(const std::string& aPath);
+  void StopInputRecording();
+  void SetAudioPoseThreshold(const float aRotation, const float aDistance);
+  // See AudioPoseChannel::Read().
+  int32_t ReadAudioPose(float* aPose) const;
   JNIEnv* GetJNIEnv() const;
+  FrameTimingsPtr GetFrameTimings() const;
+  FrameHistogramPtr GetFrameHistogram() const;
+  FrameSchedulerPtr GetScheduler() const;
+  // Nanoseconds queued Java work may take before the next frame, or
+  // RunnableQueue::kNoBudget while paused, when there is no frame to protect.
+  int64_t GetRunnableBudget() const;
+  // Widgets tested against the view frustum in the last frame, and how many
+  // of them were outside it.
+  void GetCullStats(int32_t& aTested, int32_t& aCulled) const;
+  HiddenAreaMaskPtr GetHiddenAreaMask() const;
+  ResolutionGovernorPtr GetResolutionGovernor() const;
 protected:
   struct State;
   BrowserWorld(State& aState);
   ~BrowserWorld();
+  void InitializeScene();
   void CreateFloor();
   void CreateControllerPointer();
 private:
@@ -0,0 +1,140 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "ClockGovernor.h"
+#include "FrameHistogram.h"
+#include "GovernorHysteresis.h"
+#include "Trace.h"
+#include "vrb/ConcreteClass.h"
+
+#include <algorithm>
+
+namespace crow {
+
+namespace {
+
+// Busy time as a fraction of the display period. Going down one level makes
+// work take longer, so the gap between the two keeps a step down from
+// immediately pushing the load back over the raise threshold.
+const float kRaiseLoad = 0.85f;
+const float kLowerLoad = 0.6f;
+// Frames under budget needed before stepping down. See GovernorHysteresis.
+const int32_t kMinHoldFrames = 120;
+const int32_t kMaxHoldFrames = 1920;
+
+struct Unit {
+  int32_t level;
+  float load;
+  bool measured;
+  GovernorHysteresis hysteresis;
+
+  Unit() : level(0), load(0.0f), measured(false), hysteresis(kMinHoldFrames, kMaxHoldFrames) {}
+
+  void Reset(const int32_t aLevel) {
+    level = aLevel;
+    load = 0.0f;
+    measured = false;
+    hysteresis.Reset();
+  }
+
+  // A negative load means it is unknown. Without a load, frames that make
+  // vsync count as under budget, so the level is probed downwards and
+  // missed frames bring it back up.
+  bool Update(const float aLoad, const bool aMissed, const int32_t aMinLevel, const int32_t aMaxLevel) {
+    const bool known = aLoad >= 0.0f;
+    if (known) {
+      load = measured ? (load * 0.75f + aLoad * 0.25f) : aLoad;
+      measured = true;
+    }
+    const GovernorHysteresis::Decision decision =
+        hysteresis.Update(aMissed, known && (load > kRaiseLoad), !known || (load < kLowerLoad));
+    int32_t target = level;
+    if (decision == GovernorHysteresis::Decision::Relieve) {
+      target = std::min(level + 1, aMaxLevel);
+    } else if (decision == GovernorHysteresis::Decision::Load) {
+      target = std::max(level - 1, aMinLevel);
+    }
+    if (target == level) {
+      return false;
+    }
+    hysteresis.Applied(decision);
+    level = target;
+    return true;
+  }
+};
+
+} // namespace
+
+struct ClockGovernor::State {
+  int32_t minLevel;
+  int32_t maxLevel;
+  Unit cpu;
+  Unit gpu;
+
+  State() : minLevel(0), maxLevel(0) {
+    cpu.Reset(maxLevel);
+    gpu.Reset(maxLevel);
+  }
+};
+
+ClockGovernorPtr
+ClockGovernor::Create() {
+  return std::make_shared<vrb::ConcreteClass<ClockGovernor, ClockGovernor::State> >();
+}
+
+void
+ClockGovernor::SetRange(const int32_t aMinLevel, const int32_t aMaxLevel, const int32_t aStartLevel) {
+  m.minLevel = aMinLevel;
+  m.maxLevel = std::max(aMinLevel, aMaxLevel);
+  const int32_t start = std::min(std::max(aStartLevel, m.minLevel), m.maxLevel);
+  m.cpu.Reset(start);
+  m.gpu.Reset(start);
+}
+
+bool
+ClockGovernor::Update(const Sample& aSample, const float aDisplayPeriod) {
+  if (aDisplayPeriod <= 0.0f) {
+    return false;
+  }
+  const float period = aDisplayPeriod * 1.0e9f;
+  const float cpuLoad = (float)aSample.cpuTime / period;
+  const float gpuLoad = aSample.gpuTime >= 0 ? (float)aSample.gpuTime / period : -1.0f;
+  bool cpuMissed = false;
+  bool gpuMissed = false;
+  if (FrameHistogram::IsMissedFrame(aSample.frameInterval, aDisplayPeriod)) {
+    // Blame whichever unit was busier. Without a GPU time, a miss the CPU
+    // cannot account for is put on the GPU.
+    if (gpuLoad >= 0.0f) {
+      cpuMissed = cpuLoad >= gpuLoad;
+      gpuMissed = !cpuMissed;
+    } else {
+      cpuMissed = cpuLoad > kRaiseLoad;
+      gpuMissed = !cpuMissed;
+    }
+  }
+  const bool cpuChanged = m.cpu.Update(cpuLoad, cpuMissed, m.minLevel, m.maxLevel);
+  const bool gpuChanged = m.gpu.Update(gpuLoad, gpuMissed, m.minLevel, m.maxLevel);
+  if (cpuChanged || gpuChanged) {
+    CROW_TRACE_COUNTER("CPULevel", m.cpu.level);
+    CROW_TRACE_COUNTER("GPULevel", m.gpu.level);
+    return true;
+  }
+  return false;
+}
+
+int32_t
+ClockGovernor::GetCPULevel() const {
+  return m.cpu.level;
+}
+
+int32_t
+ClockGovernor::GetGPULevel() const {
+  return m.gpu.level;
+}
+
+ClockGovernor::ClockGovernor(State& aState) : m(aState) {}
+ClockGovernor::~ClockGovernor() {}
+
+} // namespace crow
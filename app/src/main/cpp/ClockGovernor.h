@@ -0,0 +1,50 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_CLOCK_GOVERNOR_DOT_H
+#define VRBROWSER_CLOCK_GOVERNOR_DOT_H
+
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+
+namespace crow {
+
+class ClockGovernor;
+typedef std::shared_ptr<ClockGovernor> ClockGovernorPtr;
+
+// Chooses CPU and GPU clock levels from per-frame timings. It only makes
+// decisions; the device delegate applies them through its runtime. Each
+// unit steps up after a few frames over budget or a missed frame, and steps
+// down only after a long run of frames well under budget. The run needed
+// doubles whenever a step down has to be undone soon after, so a workload
+// sitting on the edge between two levels does not flip back and forth.
+class ClockGovernor {
+public:
+  struct Sample {
+    int64_t cpuTime; // Nanoseconds.
+    int64_t gpuTime; // Nanoseconds, negative if the runtime does not report it.
+    int64_t frameInterval; // Nanoseconds since the previous frame began, 0 if unknown.
+  };
+  static ClockGovernorPtr Create();
+  // Both units restart at aStartLevel, clamped to the range.
+  void SetRange(const int32_t aMinLevel, const int32_t aMaxLevel, const int32_t aStartLevel);
+  // Returns true if either level changed.
+  bool Update(const Sample& aSample, const float aDisplayPeriod);
+  int32_t GetCPULevel() const;
+  int32_t GetGPULevel() const;
+protected:
+  struct State;
+  ClockGovernor(State& aState);
+  ~ClockGovernor();
+private:
+  State& m;
+  ClockGovernor() = delete;
+  VRB_NO_DEFAULTS(ClockGovernor)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_CLOCK_GOVERNOR_DOT_H
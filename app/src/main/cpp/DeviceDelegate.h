@@ -12,6 +12,7 @@
 #include "GestureDelegate.h"
 
 #include <memory>
+#include <vector>
 
 namespace crow {
 
@@ -32,9 +33,21 @@ public:
   virtual void ReleaseControllerDelegate() = 0;
   virtual int32_t GetControllerModelCount() const = 0;
   virtual const std::string GetControllerModelName(const int32_t aModelIndex) const = 0;
+  // Seconds between display refreshes.
+  virtual float GetDisplayPeriod() const = 0;
+  // FrameTimings::Now() nanoseconds at which the frame begun by StartFrame()
+  // is expected to reach the display, or 0 if the runtime does not say.
+  virtual int64_t GetPredictedDisplayTime() const = 0;
+  // Triangles covering the part of the eye buffer the lens never shows, as x, y
+  // pairs in normalized device coordinates. Returns false if unknown.
+  virtual bool GetHiddenAreaMesh(const CameraEnum aWhich, std::vector<float>& aVertices) const = 0;
   virtual void ProcessEvents() = 0;
   virtual void StartFrame() = 0;
   virtual void BindEye(const CameraEnum aWhich) = 0;
+  // Fraction of the eye buffer width and height to render into, passed on to
+  // the compositor as the source rectangle. Takes effect on the next frame.
+  // Returns false if the device always renders the full buffer.
+  virtual bool SetRenderScale(const float aScale) = 0;
   virtual void EndFrame() = 0;
 protected:
   DeviceDelegate() {}
@@ -0,0 +1,67 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "EyeBufferHints.h"
+
+#include <GLES3/gl3.h>
+#include <algorithm>
+
+namespace crow {
+
+namespace {
+
+const GLenum kDiscarded[] = { GL_DEPTH_ATTACHMENT, GL_STENCIL_ATTACHMENT };
+const GLsizei kDiscardedCount = sizeof(kDiscarded) / sizeof(kDiscarded[0]);
+
+thread_local int64_t sBytesAvoided = 0;
+
+GLint
+GetAttachmentBits(const GLenum aAttachment, const GLenum aSize) {
+  GLint type = GL_NONE;
+  VRB_GL_CHECK(glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, aAttachment,
+                                                     GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type));
+  if (type == GL_NONE) {
+    return 0;
+  }
+  GLint bits = 0;
+  VRB_GL_CHECK(glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, aAttachment, aSize, &bits));
+  return bits;
+}
+
+// Bytes per sample of the bound framebuffer's depth and stencil, as allocated
+// by whichever runtime or vrb::FBO created it. A packed depth stencil
+// attachment reports its depth and stencil bits through both attachment points.
+int64_t
+GetDepthStencilBytes() {
+  const GLint bits = GetAttachmentBits(GL_DEPTH_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE) +
+                     GetAttachmentBits(GL_STENCIL_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE);
+  return ((int64_t)bits + 7) / 8;
+}
+
+} // namespace
+
+void
+EyeBufferHints::BeginPass() {
+  VRB_GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT));
+}
+
+void
+EyeBufferHints::EndPass(const GLsizei aWidth, const GLsizei aHeight, const int32_t aSamples) {
+  const int64_t bytes = GetDepthStencilBytes();
+  VRB_GL_CHECK(glInvalidateFramebuffer(GL_FRAMEBUFFER, kDiscardedCount, kDiscarded));
+  sBytesAvoided += (int64_t)aWidth * (int64_t)aHeight * (int64_t)std::max(1, aSamples) * bytes;
+}
+
+int64_t
+EyeBufferHints::GetBytesAvoided() {
+  return sBytesAvoided;
+}
+
+void
+EyeBufferHints::ResetCounters() {
+  sBytesAvoided = 0;
+}
+
+} // namespace crow
@@ -0,0 +1,37 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_EYE_BUFFER_HINTS_DOT_H
+#define VRBROWSER_EYE_BUFFER_HINTS_DOT_H
+
+#include "vrb/GLError.h"
+
+#include <cstdint>
+
+namespace crow {
+
+// Load and store hints for an eye pass. Tiled GPUs load each tile's
+// attachments from memory unless they are cleared first, and write them back
+// unless they are invalidated afterwards. Every eye pass starts with a full
+// clear and ends by discarding depth and stencil, which nothing reads once
+// the eye is drawn. Render thread only.
+class EyeBufferHints {
+public:
+  // Call once the eye FBO is bound and its viewport set.
+  static void BeginPass();
+  // Call while the eye FBO is still bound, before it is unbound and resolved.
+  // The size and sample count are those the attachments were allocated with;
+  // the depth and stencil formats are read from the bound framebuffer.
+  static void EndPass(const GLsizei aWidth, const GLsizei aHeight, const int32_t aSamples);
+  // Bytes of depth and stencil write back avoided since the last reset.
+  static int64_t GetBytesAvoided();
+  static void ResetCounters();
+private:
+  EyeBufferHints() = delete;
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_EYE_BUFFER_HINTS_DOT_H
@@ -0,0 +1,131 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "FrameHistogram.h"
+#include "vrb/ConcreteClass.h"
+
+#include <array>
+#include <atomic>
+
+namespace crow {
+
+namespace {
+
+const double kNanosecondsPerMillisecond = 1000000.0;
+
+} // namespace
+
+struct FrameHistogram::State {
+  // The extra bucket holds every sample past the last bucket.
+  std::array<std::atomic<uint32_t>, kBucketCount + 1> buckets;
+  std::atomic<uint64_t> frames;
+  std::atomic<uint64_t> missedFrames;
+  std::atomic<uint64_t> droppedFrames;
+  std::atomic<int64_t> total;
+  std::atomic<int64_t> max;
+  std::atomic<float> displayPeriod;
+  std::atomic<bool> resetRequested;
+  State() : displayPeriod(0.0f), resetRequested(false) {
+    Clear();
+  }
+
+  void Clear() {
+    for (std::atomic<uint32_t>& bucket: buckets) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    frames.store(0, std::memory_order_relaxed);
+    missedFrames.store(0, std::memory_order_relaxed);
+    droppedFrames.store(0, std::memory_order_relaxed);
+    total.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+  }
+
+  double Percentile(const double aPercent, const uint64_t aFrames) const {
+    const uint64_t target = (uint64_t)(aPercent * (double)aFrames + 0.5);
+    uint64_t count = 0;
+    for (int32_t index = 0; index <= kBucketCount; index++) {
+      count += buckets[index].load(std::memory_order_relaxed);
+      if ((count > 0) && (count >= target)) {
+        if (index == kBucketCount) {
+          return (double)max.load(std::memory_order_relaxed) / kNanosecondsPerMillisecond;
+        }
+        // Report the upper edge of the bucket so the percentile is never optimistic.
+        return (double)((index + 1) * kBucketWidth) / kNanosecondsPerMillisecond;
+      }
+    }
+    return 0.0;
+  }
+};
+
+bool
+FrameHistogram::IsMissedFrame(const int64_t aFrameTime, const float aDisplayPeriod) {
+  if (aDisplayPeriod <= 0.0f) {
+    return false;
+  }
+  const int64_t period = (int64_t)((double)aDisplayPeriod * 1000000000.0);
+  return aFrameTime > (period + period / 2);
+}
+
+FrameHistogramPtr
+FrameHistogram::Create() {
+  return std::make_shared<vrb::ConcreteClass<FrameHistogram, FrameHistogram::State> >();
+}
+
+void
+FrameHistogram::AddSample(const int64_t aFrameTime, const float aDisplayPeriod) {
+  if (m.resetRequested.exchange(false, std::memory_order_acq_rel)) {
+    m.Clear();
+  }
+  if (aFrameTime < 0) {
+    return;
+  }
+  int64_t index = aFrameTime / kBucketWidth;
+  if (index > kBucketCount) {
+    index = kBucketCount;
+  }
+  m.buckets[index].fetch_add(1, std::memory_order_relaxed);
+  m.frames.fetch_add(1, std::memory_order_relaxed);
+  m.total.fetch_add(aFrameTime, std::memory_order_relaxed);
+  if (aFrameTime > m.max.load(std::memory_order_relaxed)) {
+    m.max.store(aFrameTime, std::memory_order_relaxed);
+  }
+  m.displayPeriod.store(aDisplayPeriod, std::memory_order_relaxed);
+  if (IsMissedFrame(aFrameTime, aDisplayPeriod)) {
+    const int64_t period = (int64_t)((double)aDisplayPeriod * 1000000000.0);
+    m.missedFrames.fetch_add(1, std::memory_order_relaxed);
+    m.droppedFrames.fetch_add((uint64_t)((aFrameTime + period / 2) / period) - 1, std::memory_order_relaxed);
+  }
+}
+
+void
+FrameHistogram::Reset() {
+  m.resetRequested.store(true, std::memory_order_release);
+}
+
+void
+FrameHistogram::GetSnapshot(Snapshot& aSnapshot) const {
+  aSnapshot = {};
+  if (m.resetRequested.load(std::memory_order_acquire)) {
+    return;
+  }
+  const uint64_t frames = m.frames.load(std::memory_order_relaxed);
+  aSnapshot.frames = (double)frames;
+  aSnapshot.missedFrames = (double)m.missedFrames.load(std::memory_order_relaxed);
+  aSnapshot.droppedFrames = (double)m.droppedFrames.load(std::memory_order_relaxed);
+  aSnapshot.displayPeriod = (double)m.displayPeriod.load(std::memory_order_relaxed) * 1000.0;
+  if (frames == 0) {
+    return;
+  }
+  aSnapshot.mean = (double)m.total.load(std::memory_order_relaxed) / (double)frames / kNanosecondsPerMillisecond;
+  aSnapshot.p50 = m.Percentile(0.5, frames);
+  aSnapshot.p95 = m.Percentile(0.95, frames);
+  aSnapshot.p99 = m.Percentile(0.99, frames);
+  aSnapshot.max = (double)m.max.load(std::memory_order_relaxed) / kNanosecondsPerMillisecond;
+}
+
+FrameHistogram::FrameHistogram(State& aState) : m(aState) {}
+FrameHistogram::~FrameHistogram() {}
+
+} // namespace crow
@@ -0,0 +1,57 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_FRAME_HISTOGRAM_DOT_H
+#define VRBROWSER_FRAME_HISTOGRAM_DOT_H
+
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+
+namespace crow {
+
+class FrameHistogram;
+typedef std::shared_ptr<FrameHistogram> FrameHistogramPtr;
+
+// Accumulates one frame time sample per frame into fixed width buckets and
+// counts the frames that missed the display deadline. Samples are added by the
+// render thread; snapshots and resets may be requested from any thread.
+class FrameHistogram {
+public:
+  static const int32_t kBucketCount = 400;
+  static const int64_t kBucketWidth = 250000; // Nanoseconds, buckets cover 0-100ms.
+  // Must be kept in sync with FrameStats.java
+  struct Snapshot {
+    double frames;
+    double missedFrames; // Frames that took longer than one and a half display periods.
+    double droppedFrames; // Display refreshes that were not presented a new frame.
+    double displayPeriod; // Milliseconds.
+    double mean; // Milliseconds.
+    double p50;
+    double p95;
+    double p99;
+    double max;
+  };
+  static const int32_t kSnapshotSize = sizeof(Snapshot) / sizeof(double);
+  // True if a frame that took aFrameTime nanoseconds missed the display
+  // deadline. Half a display period of jitter is allowed.
+  static bool IsMissedFrame(const int64_t aFrameTime, const float aDisplayPeriod);
+  static FrameHistogramPtr Create();
+  void AddSample(const int64_t aFrameTime, const float aDisplayPeriod);
+  void Reset();
+  void GetSnapshot(Snapshot& aSnapshot) const;
+protected:
+  struct State;
+  FrameHistogram(State& aState);
+  ~FrameHistogram();
+private:
+  State& m;
+  FrameHistogram() = delete;
+  VRB_NO_DEFAULTS(FrameHistogram)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_FRAME_HISTOGRAM_DOT_H
@@ -0,0 +1,189 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "FrameScheduler.h"
+#include "FrameTimings.h"
+#include "Trace.h"
+#include "vrb/ConcreteClass.h"
+
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+
+namespace crow {
+
+namespace {
+
+const int32_t kHistorySize = 8;
+
+struct Cost {
+  int64_t average;
+  bool measured;
+};
+
+struct Job {
+  std::function<void()> run;
+  uint32_t frame;
+  Cost* cost; // Entry in State::costs, which never moves.
+};
+
+} // namespace
+
+struct FrameScheduler::State {
+  std::deque<Job> jobs[kPriorityCount];
+  std::unordered_map<std::string, Cost> costs;
+  int64_t latencies[kHistorySize];
+  int32_t historyCount;
+  int32_t historyIndex;
+  uint32_t frame;
+  int64_t frameStart;
+  int64_t displayPeriod;
+  int64_t deadline;
+
+  State()
+      : historyCount(0)
+      , historyIndex(0)
+      , frame(0)
+      , frameStart(0)
+      , displayPeriod(0)
+      , deadline(0)
+  {
+    for (int32_t index = 0; index < kHistorySize; index++) {
+      latencies[index] = 0;
+    }
+  }
+
+  int64_t MaxLatency() const {
+    int64_t result = 0;
+    for (int32_t index = 0; index < historyCount; index++) {
+      result = std::max(result, latencies[index]);
+    }
+    return result;
+  }
+
+  int32_t FindStarved() const {
+    for (int32_t priority = 0; priority < kPriorityCount; priority++) {
+      if (!jobs[priority].empty() && ((frame - jobs[priority].front().frame) >= kStarvationFrames)) {
+        return priority;
+      }
+    }
+    return -1;
+  }
+
+  // Jobs of one priority run in order, except that a job whose key is too
+  // expensive for the slack does not hold up cheaper ones behind it.
+  bool FindFitting(const int64_t aNow, int32_t& aPriority, size_t& aIndex) const {
+    for (int32_t priority = 0; priority < kPriorityCount; priority++) {
+      for (size_t index = 0; index < jobs[priority].size(); index++) {
+        if ((aNow + jobs[priority][index].cost->average) <= (deadline - kSafetyMargin)) {
+          aPriority = priority;
+          aIndex = index;
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+};
+
+const int32_t FrameScheduler::kPriorityCount;
+const int32_t FrameScheduler::kStarvationFrames;
+const int64_t FrameScheduler::kSafetyMargin;
+
+FrameSchedulerPtr
+FrameScheduler::Create() {
+  return std::make_shared<vrb::ConcreteClass<FrameScheduler, FrameScheduler::State> >();
+}
+
+void
+FrameScheduler::Post(const Priority aPriority, const std::string& aCostKey, const int64_t aEstimate,
+                     std::function<void()>&& aJob) {
+  if (!aJob) {
+    return;
+  }
+  auto it = m.costs.find(aCostKey);
+  if (it == m.costs.end()) {
+    it = m.costs.emplace(aCostKey, Cost{aEstimate, false}).first;
+  }
+  Job job;
+  job.run = std::move(aJob);
+  job.frame = m.frame;
+  job.cost = &it->second;
+  m.jobs[(int32_t)aPriority].push_back(std::move(job));
+}
+
+void
+FrameScheduler::StartFrame(const int64_t aFrameStart, const float aDisplayPeriod) {
+  m.frame++;
+  m.frameStart = aFrameStart;
+  m.displayPeriod = (int64_t)(aDisplayPeriod * 1.0e9f);
+}
+
+void
+FrameScheduler::EndFrame(const int64_t aFrameEnd, const int64_t aDisplayTime) {
+  // Without a display time the frame is assumed to be displayed as soon as
+  // it is submitted, which makes the deadline one period after frame start.
+  const int64_t displayTime = aDisplayTime > 0 ? aDisplayTime : aFrameEnd;
+  m.latencies[m.historyIndex] = displayTime - m.frameStart;
+  m.historyIndex = (m.historyIndex + 1) % kHistorySize;
+  m.historyCount = std::min(m.historyCount + 1, kHistorySize);
+  m.deadline = displayTime + m.displayPeriod - m.MaxLatency();
+}
+
+bool
+FrameScheduler::GetSlack(const int64_t aNow, int64_t& aSlack) const {
+  if (m.historyCount == 0) {
+    return false;
+  }
+  aSlack = m.deadline - kSafetyMargin - aNow;
+  return true;
+}
+
+int32_t
+FrameScheduler::RunSlack() {
+  if (m.historyCount == 0) {
+    return 0;
+  }
+  CROW_TRACE_SCOPE("FrameScheduler::RunSlack");
+  CROW_TRACE_COUNTER("SchedulerSlack", (double)(m.deadline - FrameTimings::Now()) / 1000000.0);
+  int32_t count = 0;
+  bool ranStarved = false;
+  while (true) {
+    const int64_t start = FrameTimings::Now();
+    int32_t priority = ranStarved ? -1 : m.FindStarved();
+    size_t index = 0;
+    if (priority >= 0) {
+      ranStarved = true;
+    } else if (!m.FindFitting(start, priority, index)) {
+      break;
+    }
+    std::deque<Job>& queue = m.jobs[priority];
+    std::function<void()> job = std::move(queue[index].run);
+    Cost& cost = *queue[index].cost;
+    queue.erase(queue.begin() + index);
+    job();
+    count++;
+    const int64_t elapsed = FrameTimings::Now() - start;
+    // Moving average so one slow job does not keep a key out for long.
+    cost.average = cost.measured ? (cost.average * 3 + elapsed) / 4 : elapsed;
+    cost.measured = true;
+  }
+  CROW_TRACE_COUNTER("SchedulerPending", GetPendingCount());
+  return count;
+}
+
+int32_t
+FrameScheduler::GetPendingCount() const {
+  size_t result = 0;
+  for (int32_t priority = 0; priority < kPriorityCount; priority++) {
+    result += m.jobs[priority].size();
+  }
+  return (int32_t)result;
+}
+
+FrameScheduler::FrameScheduler(State& aState) : m(aState) {}
+FrameScheduler::~FrameScheduler() {}
+
+} // namespace crow
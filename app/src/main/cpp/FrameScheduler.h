@@ -0,0 +1,66 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_FRAME_SCHEDULER_DOT_H
+#define VRBROWSER_FRAME_SCHEDULER_DOT_H
+
+#include "vrb/MacroUtils.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace crow {
+
+class FrameScheduler;
+typedef std::shared_ptr<FrameScheduler> FrameSchedulerPtr;
+
+// Runs deferrable render thread jobs in the time left between the end of one
+// frame and the latest moment the next frame can start and still make its
+// vsync. That moment is the next display time minus the longest start to
+// display latency of recent frames. Each job is posted with a cost key, and the
+// cost of jobs is averaged per key, so a small task and a model load at the
+// same priority are not estimated alike. A job runs only if the average cost
+// for its key fits in the slack; jobs that do not fit wait for the next frame
+// and do not hold up cheaper jobs behind them. A job that has waited
+// kStarvationFrames frames runs regardless, at most one per frame. Render
+// thread only.
+class FrameScheduler {
+public:
+  enum class Priority {
+    High,
+    Normal,
+    Low
+  };
+  static const int32_t kPriorityCount = 3;
+  static const int32_t kStarvationFrames = 8;
+  static const int64_t kSafetyMargin = 500000; // Nanoseconds.
+
+  static FrameSchedulerPtr Create();
+  // aEstimate is the cost in nanoseconds assumed for aCostKey until a job
+  // posted with that key has been measured.
+  void Post(const Priority aPriority, const std::string& aCostKey, const int64_t aEstimate,
+            std::function<void()>&& aJob);
+  void StartFrame(const int64_t aFrameStart, const float aDisplayPeriod);
+  // aDisplayTime is DeviceDelegate::GetPredictedDisplayTime(), 0 if unknown.
+  void EndFrame(const int64_t aFrameEnd, const int64_t aDisplayTime);
+  // Returns false until a frame has been measured.
+  bool GetSlack(const int64_t aNow, int64_t& aSlack) const;
+  // Returns the number of jobs run.
+  int32_t RunSlack();
+  int32_t GetPendingCount() const;
+protected:
+  struct State;
+  FrameScheduler(State& aState);
+  ~FrameScheduler();
+private:
+  State& m;
+  FrameScheduler() = delete;
+  VRB_NO_DEFAULTS(FrameScheduler)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_FRAME_SCHEDULER_DOT_H
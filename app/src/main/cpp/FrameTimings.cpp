@@ -0,0 +1,180 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "FrameTimings.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/Logger.h"
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <time.h>
+#include <vector>
+
+namespace crow {
+
+namespace {
+
+// Each slot is guarded by a sequence counter which is odd while the render
+// thread is writing it. Readers skip a slot that
+// changed underneath them instead of retrying.
+struct Slot {
+  std::atomic<uint32_t> sequence;
+  FrameTimings::Record record;
+  Slot() : sequence(0) {
+    memset(&record, 0, sizeof(record));
+  }
+};
+
+const char* kPhaseNames[] = {
+  "ProcessEvents",
+  "ContextUpdate",
+  "UpdateControllers",
+  "Cull",
+  "StartFrame",
+  "DrawLeft",
+  "DrawRight",
+  "EndFrame",
+  "AudioPose"
+};
+
+static_assert(sizeof(kPhaseNames) / sizeof(kPhaseNames[0]) == FrameTimings::kPhaseCount,
+              "Phase names must match FrameTimings::Phase");
+
+} // namespace
+
+struct FrameTimings::State {
+  std::array<Slot, kCapacity> slots;
+  std::atomic<uint64_t> frameCount;
+  Record current;
+  int64_t lastMark;
+  bool inFrame;
+  State() : frameCount(0), lastMark(0), inFrame(false) {
+    memset(&current, 0, sizeof(current));
+  }
+};
+
+FrameTimingsPtr
+FrameTimings::Create() {
+  return std::make_shared<vrb::ConcreteClass<FrameTimings, FrameTimings::State> >();
+}
+
+int64_t
+FrameTimings::Now() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((int64_t)now.tv_sec * 1000000000LL) + (int64_t)now.tv_nsec;
+}
+
+const char*
+FrameTimings::GetPhaseName(const Phase aPhase) {
+  const int32_t index = (int32_t)aPhase;
+  if ((index < 0) || (index >= kPhaseCount)) {
+    return "Unknown";
+  }
+  return kPhaseNames[index];
+}
+
+void
+FrameTimings::StartFrame() {
+  memset(m.current.phases, 0, sizeof(m.current.phases));
+  m.current.frame = m.frameCount.load(std::memory_order_relaxed);
+  m.current.start = Now();
+  m.lastMark = m.current.start;
+  m.inFrame = true;
+}
+
+void
+FrameTimings::EndPhase(const Phase aPhase) {
+  if (!m.inFrame) {
+    return;
+  }
+  const int64_t now = Now();
+  m.current.phases[(int32_t)aPhase] += now - m.lastMark;
+  m.lastMark = now;
+}
+
+void
+FrameTimings::EndFrame() {
+  if (!m.inFrame) {
+    return;
+  }
+  m.inFrame = false;
+  const uint64_t frame = m.current.frame;
+  Slot& slot = m.slots[frame % kCapacity];
+  const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.record = m.current;
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+  m.frameCount.store(frame + 1, std::memory_order_release);
+}
+
+uint64_t
+FrameTimings::GetFrameCount() const {
+  return m.frameCount.load(std::memory_order_acquire);
+}
+
+int32_t
+FrameTimings::GetRecentRecords(Record* aRecords, const int32_t aMaxRecords) const {
+  if (!aRecords || (aMaxRecords <= 0)) {
+    return 0;
+  }
+  const uint64_t count = m.frameCount.load(std::memory_order_acquire);
+  uint64_t available = count < kCapacity ? count : kCapacity;
+  if (available > (uint64_t)aMaxRecords) {
+    available = (uint64_t)aMaxRecords;
+  }
+  int32_t result = 0;
+  for (uint64_t frame = count - available; frame < count; frame++) {
+    const Slot& slot = m.slots[frame % kCapacity];
+    const uint32_t before = slot.sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+      continue;
+    }
+    Record record = slot.record;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint32_t after = slot.sequence.load(std::memory_order_relaxed);
+    if ((before != after) || (record.frame != frame)) {
+      continue;
+    }
+    aRecords[result] = record;
+    result++;
+  }
+  return result;
+}
+
+bool
+FrameTimings::Dump(const std::string& aPath) const {
+  std::vector<Record> records(kCapacity);
+  const int32_t count = GetRecentRecords(records.data(), kCapacity);
+  FILE* file = fopen(aPath.c_str(), "w");
+  if (!file) {
+    VRB_LOG("Unable to open frame timing dump: %s", aPath.c_str());
+    return false;
+  }
+  fprintf(file, "frame,start_ns");
+  for (int32_t phase = 0; phase < kPhaseCount; phase++) {
+    fprintf(file, ",%s_ns", kPhaseNames[phase]);
+  }
+  fprintf(file, "\n");
+  for (int32_t index = 0; index < count; index++) {
+    const Record& record = records[index];
+    fprintf(file, "%llu,%lld", (unsigned long long)record.frame, (long long)record.start);
+    for (int32_t phase = 0; phase < kPhaseCount; phase++) {
+      fprintf(file, ",%lld", (long long)record.phases[phase]);
+    }
+    fprintf(file, "\n");
+  }
+  fclose(file);
+  VRB_LOG("Dumped %d frame timings to: %s", count, aPath.c_str());
+  return true;
+}
+
+FrameTimings::FrameTimings(State& aState) : m(aState) {}
+FrameTimings::~FrameTimings() {}
+
+} // namespace crow
@@ -0,0 +1,67 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_FRAME_TIMINGS_DOT_H
+#define VRBROWSER_FRAME_TIMINGS_DOT_H
+
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+#include <string>
+
+namespace crow {
+
+class FrameTimings;
+typedef std::shared_ptr<FrameTimings> FrameTimingsPtr;
+
+// Records how long each phase of BrowserWorld::Draw takes. The render thread is
+// the only writer; completed frames are published into a fixed size ring buffer
+// that may be read from any thread without locking.
+class FrameTimings {
+public:
+  // Must be kept in sync with VRBrowserActivity.java
+  enum class Phase {
+    ProcessEvents = 0,
+    ContextUpdate,
+    UpdateControllers,
+    Cull,
+    StartFrame,
+    DrawLeft,
+    DrawRight,
+    EndFrame,
+    AudioPose,
+    Count
+  };
+  static const int32_t kPhaseCount = (int32_t)Phase::Count;
+  static const int32_t kCapacity = 256;
+  struct Record {
+    uint64_t frame;
+    int64_t start; // Monotonic clock, nanoseconds.
+    int64_t phases[kPhaseCount]; // Nanoseconds spent in each phase.
+  };
+  static FrameTimingsPtr Create();
+  static int64_t Now();
+  static const char* GetPhaseName(const Phase aPhase);
+  void StartFrame();
+  void EndPhase(const Phase aPhase);
+  void EndFrame();
+  uint64_t GetFrameCount() const;
+  // Copies up to aMaxRecords of the most recently completed frames, oldest
+  // first, and returns the number copied.
+  int32_t GetRecentRecords(Record* aRecords, const int32_t aMaxRecords) const;
+  bool Dump(const std::string& aPath) const;
+protected:
+  struct State;
+  FrameTimings(State& aState);
+  ~FrameTimings();
+private:
+  State& m;
+  FrameTimings() = delete;
+  VRB_NO_DEFAULTS(FrameTimings)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_FRAME_TIMINGS_DOT_H
@@ -0,0 +1,124 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "Frustum.h"
+#include "vrb/Camera.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/Matrix.h"
+#include "vrb/Vector.h"
+
+#include <cmath>
+
+namespace crow {
+
+namespace {
+
+const int32_t kEyeCount = 2;
+const int32_t kPlaneCount = 4;
+// Sine of the head rotation the margin covers, about ten degrees.
+const float kMotionMargin = 0.17f;
+
+struct Plane {
+  vrb::Vector normal; // Points into the frustum.
+  float offset;
+
+  float Distance(const vrb::Vector& aPoint) const {
+    return normal.Dot(aPoint) + offset;
+  }
+};
+
+struct Eye {
+  vrb::Vector position;
+  Plane planes[kPlaneCount];
+};
+
+bool
+SetEye(const vrb::Camera& aCamera, Eye& aEye) {
+  const vrb::Matrix inversePerspective = aCamera.GetPerspective().Inverse();
+  const vrb::Matrix& transform = aCamera.GetTransform();
+  const vrb::Vector ndc[kPlaneCount] = {
+    vrb::Vector(-1.0f, -1.0f, -1.0f),
+    vrb::Vector(1.0f, -1.0f, -1.0f),
+    vrb::Vector(1.0f, 1.0f, -1.0f),
+    vrb::Vector(-1.0f, 1.0f, -1.0f)
+  };
+  vrb::Vector corners[kPlaneCount];
+  vrb::Vector center;
+  for (int32_t index = 0; index < kPlaneCount; index++) {
+    corners[index] = transform.MultiplyPosition(inversePerspective.MultiplyPosition(ndc[index]));
+    center += corners[index] * (1.0f / kPlaneCount);
+  }
+  aEye.position = transform.GetTranslation();
+  const vrb::Vector inside = aEye.position + ((center - aEye.position) * 2.0f);
+  for (int32_t index = 0; index < kPlaneCount; index++) {
+    const vrb::Vector& first = corners[index];
+    const vrb::Vector& second = corners[(index + 1) % kPlaneCount];
+    vrb::Vector normal = (first - aEye.position).Cross(second - aEye.position);
+    const float length = normal.Magnitude();
+    if (!(length > 1.0e-6f)) { // Also catches NaN.
+      return false;
+    }
+    normal = normal * (1.0f / length);
+    if (normal.Dot(inside - aEye.position) < 0.0f) {
+      normal = -normal;
+    }
+    aEye.planes[index].normal = normal;
+    aEye.planes[index].offset = -normal.Dot(aEye.position);
+  }
+  return true;
+}
+
+} // namespace
+
+struct Frustum::State {
+  Eye eyes[kEyeCount];
+  bool valid;
+
+  State() : valid(false) {}
+
+  bool Outside(const Eye& aEye, const vrb::Vector& aMin, const vrb::Vector& aMax, const float aMargin) const {
+    for (const Plane& plane: aEye.planes) {
+      // The corner furthest along the plane normal.
+      const vrb::Vector corner(plane.normal.x() >= 0.0f ? aMax.x() : aMin.x(),
+                               plane.normal.y() >= 0.0f ? aMax.y() : aMin.y(),
+                               plane.normal.z() >= 0.0f ? aMax.z() : aMin.z());
+      if (plane.Distance(corner) < -aMargin) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+FrustumPtr
+Frustum::Create() {
+  return std::make_shared<vrb::ConcreteClass<Frustum, Frustum::State> >();
+}
+
+bool
+Frustum::Set(const vrb::Camera& aLeft, const vrb::Camera& aRight) {
+  m.valid = SetEye(aLeft, m.eyes[0]) && SetEye(aRight, m.eyes[1]);
+  return m.valid;
+}
+
+bool
+Frustum::IsVisible(const vrb::Vector& aMin, const vrb::Vector& aMax) const {
+  if (!m.valid) {
+    return true;
+  }
+  const vrb::Vector center = (aMin + aMax) * 0.5f;
+  for (const Eye& eye: m.eyes) {
+    const float margin = (center - eye.position).Magnitude() * kMotionMargin;
+    if (!m.Outside(eye, aMin, aMax, margin)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Frustum::Frustum(State& aState) : m(aState) {}
+Frustum::~Frustum() {}
+
+} // namespace crow
@@ -0,0 +1,42 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_FRUSTUM_DOT_H
+#define VRBROWSER_FRUSTUM_DOT_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+
+namespace crow {
+
+class Frustum;
+typedef std::shared_ptr<Frustum> FrustumPtr;
+
+// Union of the left and right eye view volumes in world space. Each eye is
+// bounded by the four side planes through the eye position; there is no near
+// or far plane. Boxes are tested with a margin that grows with distance so a
+// frame of head motion does not make geometry pop in at the edges.
+class Frustum {
+public:
+  static FrustumPtr Create();
+  // Returns false if the cameras do not describe a usable frustum, in which
+  // case everything is reported as visible.
+  bool Set(const vrb::Camera& aLeft, const vrb::Camera& aRight);
+  bool IsVisible(const vrb::Vector& aMin, const vrb::Vector& aMax) const;
+protected:
+  struct State;
+  Frustum(State& aState);
+  ~Frustum();
+private:
+  State& m;
+  Frustum() = delete;
+  VRB_NO_DEFAULTS(Frustum)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_FRUSTUM_DOT_H
@@ -0,0 +1,200 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "GLStateCache.h"
+
+namespace crow {
+
+namespace {
+
+enum class Tracked {
+  Blend,
+  CullFace,
+  DepthTest,
+  ScissorTest,
+  Count
+};
+
+const int32_t kTrackedCount = (int32_t)Tracked::Count;
+
+struct Rect {
+  GLint x, y;
+  GLsizei width, height;
+
+  bool Equals(const GLint aX, const GLint aY, const GLsizei aWidth, const GLsizei aHeight) const {
+    return (x == aX) && (y == aY) && (width == aWidth) && (height == aHeight);
+  }
+  void Set(const GLint aX, const GLint aY, const GLsizei aWidth, const GLsizei aHeight) {
+    x = aX; y = aY; width = aWidth; height = aHeight;
+  }
+};
+
+// Each value has a matching known flag; an unknown value is always issued.
+struct ShadowState {
+  bool capabilityKnown[kTrackedCount];
+  bool capability[kTrackedCount];
+  bool blendKnown;
+  GLenum blendSource;
+  GLenum blendDestination;
+  bool clearColorKnown;
+  GLfloat clearColor[4];
+  bool viewportKnown;
+  Rect viewport;
+  bool scissorKnown;
+  Rect scissor;
+  GLStateCache::Counters counters;
+
+  ShadowState() : counters{0, 0} {
+    Invalidate();
+  }
+
+  void Invalidate() {
+    for (int32_t index = 0; index < kTrackedCount; index++) {
+      capabilityKnown[index] = false;
+    }
+    blendKnown = false;
+    clearColorKnown = false;
+    viewportKnown = false;
+    scissorKnown = false;
+  }
+
+  // Returns true if the call should be issued and counts it either way.
+  bool Count(const bool aChanged) {
+    if (aChanged) {
+      counters.issued++;
+    } else {
+      counters.elided++;
+    }
+    return aChanged;
+  }
+};
+
+thread_local ShadowState sState;
+
+int32_t
+GetTrackedIndex(const GLenum aCapability) {
+  switch (aCapability) {
+    case GL_BLEND: return (int32_t)Tracked::Blend;
+    case GL_CULL_FACE: return (int32_t)Tracked::CullFace;
+    case GL_DEPTH_TEST: return (int32_t)Tracked::DepthTest;
+    case GL_SCISSOR_TEST: return (int32_t)Tracked::ScissorTest;
+    default: return -1;
+  }
+}
+
+bool
+SetCapability(const GLenum aCapability, const bool aEnabled) {
+  const int32_t index = GetTrackedIndex(aCapability);
+  if (index < 0) {
+    return sState.Count(true);
+  }
+  const bool changed = !sState.capabilityKnown[index] || (sState.capability[index] != aEnabled);
+  sState.capabilityKnown[index] = true;
+  sState.capability[index] = aEnabled;
+  return sState.Count(changed);
+}
+
+} // namespace
+
+void
+GLStateCache::Enable(const GLenum aCapability) {
+  if (SetCapability(aCapability, true)) {
+    VRB_GL_CHECK(glEnable(aCapability));
+  }
+}
+
+void
+GLStateCache::Disable(const GLenum aCapability) {
+  if (SetCapability(aCapability, false)) {
+    VRB_GL_CHECK(glDisable(aCapability));
+  }
+}
+
+bool
+GLStateCache::IsEnabled(const GLenum aCapability) {
+  const int32_t index = GetTrackedIndex(aCapability);
+  if (index < 0) {
+    return glIsEnabled(aCapability) == GL_TRUE;
+  }
+  if (!sState.capabilityKnown[index]) {
+    sState.capabilityKnown[index] = true;
+    sState.capability[index] = glIsEnabled(aCapability) == GL_TRUE;
+  }
+  return sState.capability[index];
+}
+
+void
+GLStateCache::BlendFunc(const GLenum aSource, const GLenum aDestination) {
+  const bool changed = !sState.blendKnown ||
+                       (sState.blendSource != aSource) ||
+                       (sState.blendDestination != aDestination);
+  if (sState.Count(changed)) {
+    sState.blendKnown = true;
+    sState.blendSource = aSource;
+    sState.blendDestination = aDestination;
+    VRB_GL_CHECK(glBlendFunc(aSource, aDestination));
+  }
+}
+
+void
+GLStateCache::ClearColor(const GLfloat aRed, const GLfloat aGreen, const GLfloat aBlue, const GLfloat aAlpha) {
+  GLfloat* color = sState.clearColor;
+  const bool changed = !sState.clearColorKnown ||
+                       (color[0] != aRed) || (color[1] != aGreen) ||
+                       (color[2] != aBlue) || (color[3] != aAlpha);
+  if (sState.Count(changed)) {
+    sState.clearColorKnown = true;
+    color[0] = aRed; color[1] = aGreen; color[2] = aBlue; color[3] = aAlpha;
+    VRB_GL_CHECK(glClearColor(aRed, aGreen, aBlue, aAlpha));
+  }
+}
+
+void
+GLStateCache::Viewport(const GLint aX, const GLint aY, const GLsizei aWidth, const GLsizei aHeight) {
+  const bool changed = !sState.viewportKnown || !sState.viewport.Equals(aX, aY, aWidth, aHeight);
+  if (sState.Count(changed)) {
+    sState.viewportKnown = true;
+    sState.viewport.Set(aX, aY, aWidth, aHeight);
+    VRB_GL_CHECK(glViewport(aX, aY, aWidth, aHeight));
+  }
+}
+
+void
+GLStateCache::Scissor(const GLint aX, const GLint aY, const GLsizei aWidth, const GLsizei aHeight) {
+  const bool changed = !sState.scissorKnown || !sState.scissor.Equals(aX, aY, aWidth, aHeight);
+  if (sState.Count(changed)) {
+    sState.scissorKnown = true;
+    sState.scissor.Set(aX, aY, aWidth, aHeight);
+    VRB_GL_CHECK(glScissor(aX, aY, aWidth, aHeight));
+  }
+}
+
+bool
+GLStateCache::GetViewportSize(GLsizei& aWidth, GLsizei& aHeight) {
+  if (!sState.viewportKnown) {
+    return false;
+  }
+  aWidth = sState.viewport.width;
+  aHeight = sState.viewport.height;
+  return true;
+}
+
+void
+GLStateCache::Invalidate() {
+  sState.Invalidate();
+}
+
+void
+GLStateCache::GetCounters(Counters& aCounters) {
+  aCounters = sState.counters;
+}
+
+void
+GLStateCache::ResetCounters() {
+  sState.counters.issued = 0;
+  sState.counters.elided = 0;
+}
+
+} // namespace crow
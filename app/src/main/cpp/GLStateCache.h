@@ -0,0 +1,47 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_GL_STATE_CACHE_DOT_H
+#define VRBROWSER_GL_STATE_CACHE_DOT_H
+
+#include "vrb/GLError.h"
+
+#include <cstdint>
+
+namespace crow {
+
+// Shadow copy of the fixed function GL state crow sets every frame. A call
+// that would not change the current value is dropped. The shadow state is
+// per thread, which matches one GL context per render thread. Anything that
+// changes GL state behind the cache's back, such as a VR runtime compositing
+// on the same context, must be followed by Invalidate().
+class GLStateCache {
+public:
+  struct Counters {
+    int32_t issued;
+    int32_t elided;
+  };
+
+  static void Enable(const GLenum aCapability);
+  static void Disable(const GLenum aCapability);
+  // Answers from the shadow state, asking the driver only if it is unknown.
+  static bool IsEnabled(const GLenum aCapability);
+  static void BlendFunc(const GLenum aSource, const GLenum aDestination);
+  static void ClearColor(const GLfloat aRed, const GLfloat aGreen, const GLfloat aBlue, const GLfloat aAlpha);
+  static void Viewport(const GLint aX, const GLint aY, const GLsizei aWidth, const GLsizei aHeight);
+  static void Scissor(const GLint aX, const GLint aY, const GLsizei aWidth, const GLsizei aHeight);
+  // Returns false if the viewport has not been set since the last Invalidate().
+  static bool GetViewportSize(GLsizei& aWidth, GLsizei& aHeight);
+  // Forgets the shadow state so the next call of each kind reaches the driver.
+  static void Invalidate();
+  static void GetCounters(Counters& aCounters);
+  static void ResetCounters();
+private:
+  GLStateCache() = delete;
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_GL_STATE_CACHE_DOT_H
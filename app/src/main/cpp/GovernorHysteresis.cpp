@@ -0,0 +1,85 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "GovernorHysteresis.h"
+
+#include <algorithm>
+
+namespace crow {
+
+namespace {
+
+// Consecutive frames over budget before the load is relieved.
+const int32_t kOverFrames = 3;
+// Frames after a change during which nothing changes again, so the effect of
+// the last change shows up in the measurements first.
+const int32_t kCooldownFrames = 10;
+
+} // namespace
+
+GovernorHysteresis::GovernorHysteresis(const int32_t aMinHoldFrames, const int32_t aMaxHoldFrames)
+    : minHoldFrames(aMinHoldFrames)
+    , maxHoldFrames(std::max(aMinHoldFrames, aMaxHoldFrames)) {
+  Reset();
+}
+
+void
+GovernorHysteresis::Reset() {
+  overFrames = 0;
+  underFrames = 0;
+  cooldown = 0;
+  holdFrames = minHoldFrames;
+  framesSinceLoad = maxHoldFrames;
+  framesSinceUndone = maxHoldFrames;
+}
+
+GovernorHysteresis::Decision
+GovernorHysteresis::Update(const bool aMissed, const bool aOver, const bool aUnder) {
+  framesSinceLoad = std::min(framesSinceLoad + 1, maxHoldFrames);
+  framesSinceUndone = std::min(framesSinceUndone + 1, maxHoldFrames);
+  if (aMissed || aOver) {
+    overFrames++;
+    underFrames = 0;
+  } else if (aUnder) {
+    underFrames++;
+    overFrames = 0;
+  } else {
+    overFrames = 0;
+    underFrames = 0;
+  }
+  if (cooldown > 0) {
+    cooldown--;
+    return Decision::None;
+  }
+  if (aMissed || (overFrames >= kOverFrames)) {
+    return Decision::Relieve;
+  }
+  if (underFrames >= holdFrames) {
+    return Decision::Load;
+  }
+  return Decision::None;
+}
+
+void
+GovernorHysteresis::Applied(const Decision aDecision) {
+  if (aDecision == Decision::Relieve) {
+    if (framesSinceLoad < holdFrames) {
+      holdFrames = std::min(holdFrames * 2, maxHoldFrames);
+      framesSinceUndone = 0;
+    }
+  } else if (aDecision == Decision::Load) {
+    framesSinceLoad = 0;
+    if (framesSinceUndone >= maxHoldFrames) {
+      holdFrames = std::max(holdFrames / 2, minHoldFrames);
+    }
+  } else {
+    return;
+  }
+  cooldown = kCooldownFrames;
+  overFrames = 0;
+  underFrames = 0;
+}
+
+} // namespace crow
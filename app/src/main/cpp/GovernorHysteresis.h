@@ -0,0 +1,48 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_GOVERNOR_HYSTERESIS_DOT_H
+#define VRBROWSER_GOVERNOR_HYSTERESIS_DOT_H
+
+#include <cstdint>
+
+namespace crow {
+
+// Shared step timing for the governors that trade quality or power against
+// frame time. A governor relieves the load quickly, after a missed frame or a
+// few frames over budget, and only loads the frame again after a long run of
+// frames under budget. That run doubles whenever a step that loaded the frame
+// has to be undone soon after, so a workload on the edge between two steps
+// does not flip back and forth, and halves again once no step has been undone
+// for the maximum hold. A value type owned by the governor's state.
+class GovernorHysteresis {
+public:
+  enum class Decision {
+    None,
+    Relieve, // Lower the load: a smaller render scale or a higher clock.
+    Load // Raise the load: a larger render scale or a lower clock.
+  };
+  GovernorHysteresis(const int32_t aMinHoldFrames, const int32_t aMaxHoldFrames);
+  void Reset();
+  // Called once per frame with whether the frame missed vsync, ran over
+  // budget or ran well under it.
+  Decision Update(const bool aMissed, const bool aOver, const bool aUnder);
+  // Called when the governor actually changed its value for aDecision, which
+  // it may not do when the value is already at its limit.
+  void Applied(const Decision aDecision);
+private:
+  int32_t minHoldFrames;
+  int32_t maxHoldFrames;
+  int32_t overFrames;
+  int32_t underFrames;
+  int32_t cooldown;
+  int32_t holdFrames;
+  int32_t framesSinceLoad;
+  int32_t framesSinceUndone;
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_GOVERNOR_HYSTERESIS_DOT_H
@@ -0,0 +1,273 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "HiddenAreaMask.h"
+#include "GLStateCache.h"
+#include "Trace.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/GLError.h"
+#include "vrb/Logger.h"
+
+#include <cmath>
+
+namespace crow {
+
+namespace {
+
+const int32_t kEyeCount = 2;
+// A multiple of eight so that rays pass through the viewport corners.
+const int32_t kLensSegments = 64;
+const GLuint kPositionLocation = 0;
+
+const char* kVertexShader = R"SHADER(
+attribute vec2 a_position;
+void main() {
+  gl_Position = vec4(a_position, -1.0, 1.0);
+}
+)SHADER";
+
+const char* kFragmentShader = R"SHADER(
+precision mediump float;
+void main() {
+  gl_FragColor = vec4(0.0);
+}
+)SHADER";
+
+GLuint
+CompileShader(const GLenum aType, const char* aSource) {
+  GLuint shader = glCreateShader(aType);
+  VRB_GL_CHECK(glShaderSource(shader, 1, &aSource, nullptr));
+  VRB_GL_CHECK(glCompileShader(shader));
+  GLint compiled = GL_FALSE;
+  VRB_GL_CHECK(glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled));
+  if (!compiled) {
+    char log[256] = {};
+    VRB_GL_CHECK(glGetShaderInfoLog(shader, sizeof(log), nullptr, log));
+    VRB_LOG("HiddenAreaMask: failed to compile shader: %s", log);
+    VRB_GL_CHECK(glDeleteShader(shader));
+    return 0;
+  }
+  return shader;
+}
+
+float
+TriangleArea(const float* aVertices) {
+  return 0.5f * std::fabs((aVertices[2] - aVertices[0]) * (aVertices[5] - aVertices[1]) -
+                          (aVertices[4] - aVertices[0]) * (aVertices[3] - aVertices[1]));
+}
+
+void
+AddTriangle(const float aAX, const float aAY, const float aBX, const float aBY,
+            const float aCX, const float aCY, std::vector<float>& aVertices) {
+  const float triangle[] = {aAX, aAY, aBX, aBY, aCX, aCY};
+  if (TriangleArea(triangle) > 1.0e-6f) {
+    aVertices.insert(aVertices.end(), triangle, triangle + 6);
+  }
+}
+
+// The area between a circle and the edges of the viewport, as a fan of rays
+// from the center. Each ray runs from the circle out to the edge. The inner
+// polygon is circumscribed so no visible pixel inside the circle is masked.
+void
+BuildLensMesh(const float aRadius, std::vector<float>& aVertices) {
+  aVertices.clear();
+  const float radius = aRadius / (float)std::cos(M_PI / (double)kLensSegments);
+  float innerX[kLensSegments + 1], innerY[kLensSegments + 1];
+  float outerX[kLensSegments + 1], outerY[kLensSegments + 1];
+  for (int32_t index = 0; index <= kLensSegments; index++) {
+    const float angle = (float)(2.0 * M_PI * (double)index / (double)kLensSegments);
+    const float x = std::cos(angle);
+    const float y = std::sin(angle);
+    const float edge = 1.0f / std::fmax(std::fabs(x), std::fabs(y));
+    const float inner = std::fmin(radius, edge);
+    innerX[index] = x * inner;
+    innerY[index] = y * inner;
+    outerX[index] = x * edge;
+    outerY[index] = y * edge;
+  }
+  for (int32_t index = 0; index < kLensSegments; index++) {
+    const int32_t next = index + 1;
+    AddTriangle(innerX[index], innerY[index], outerX[index], outerY[index],
+                outerX[next], outerY[next], aVertices);
+    AddTriangle(innerX[index], innerY[index], outerX[next], outerY[next],
+                innerX[next], innerY[next], aVertices);
+  }
+}
+
+struct Eye {
+  std::vector<float> vertices;
+  float coverage;
+  GLuint buffer;
+  bool uploaded;
+
+  Eye() : coverage(0.0f), buffer(0), uploaded(false) {}
+
+  void Set(const std::vector<float>& aVertices) {
+    vertices = aVertices;
+    vertices.resize(vertices.size() - (vertices.size() % 6));
+    float area = 0.0f;
+    for (size_t index = 0; index < vertices.size(); index += 6) {
+      area += TriangleArea(&vertices[index]);
+    }
+    // Normalized device coordinates span an area of four.
+    coverage = std::fmin(area / 4.0f, 1.0f);
+    uploaded = false;
+  }
+};
+
+} // namespace
+
+struct HiddenAreaMask::State {
+  Eye eyes[kEyeCount];
+  GLuint program;
+  bool glInitialized;
+  int64_t maskedPixels;
+
+  State() : program(0), glInitialized(false), maskedPixels(0) {}
+
+  static int32_t EyeIndex(const DeviceDelegate::CameraEnum aWhich) {
+    return aWhich == DeviceDelegate::CameraEnum::Left ? 0 : 1;
+  }
+
+  void Upload(Eye& aEye) {
+    if (!aEye.buffer) {
+      VRB_GL_CHECK(glGenBuffers(1, &aEye.buffer));
+    }
+    VRB_GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, aEye.buffer));
+    VRB_GL_CHECK(glBufferData(GL_ARRAY_BUFFER, aEye.vertices.size() * sizeof(float),
+                              aEye.vertices.data(), GL_STATIC_DRAW));
+    aEye.uploaded = true;
+  }
+};
+
+HiddenAreaMaskPtr
+HiddenAreaMask::Create() {
+  return std::make_shared<vrb::ConcreteClass<HiddenAreaMask, HiddenAreaMask::State> >();
+}
+
+void
+HiddenAreaMask::SetMesh(const DeviceDelegate::CameraEnum aWhich, const std::vector<float>& aVertices) {
+  m.eyes[State::EyeIndex(aWhich)].Set(aVertices);
+}
+
+void
+HiddenAreaMask::SetLensRadius(const float aRadius) {
+  std::vector<float> vertices;
+  if (aRadius > 0.0f) {
+    BuildLensMesh(aRadius, vertices);
+  }
+  for (Eye& eye: m.eyes) {
+    eye.Set(vertices);
+  }
+}
+
+bool
+HiddenAreaMask::IsEnabled() const {
+  for (const Eye& eye: m.eyes) {
+    if (!eye.vertices.empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+HiddenAreaMask::InitializeGL() {
+  if (m.glInitialized) {
+    return;
+  }
+  GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, kVertexShader);
+  GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, kFragmentShader);
+  if (vertexShader && fragmentShader) {
+    m.program = glCreateProgram();
+    VRB_GL_CHECK(glAttachShader(m.program, vertexShader));
+    VRB_GL_CHECK(glAttachShader(m.program, fragmentShader));
+    VRB_GL_CHECK(glBindAttribLocation(m.program, kPositionLocation, "a_position"));
+    VRB_GL_CHECK(glLinkProgram(m.program));
+    GLint linked = GL_FALSE;
+    VRB_GL_CHECK(glGetProgramiv(m.program, GL_LINK_STATUS, &linked));
+    if (!linked) {
+      VRB_LOG("HiddenAreaMask: failed to link program");
+      VRB_GL_CHECK(glDeleteProgram(m.program));
+      m.program = 0;
+    }
+  }
+  if (vertexShader) {
+    VRB_GL_CHECK(glDeleteShader(vertexShader));
+  }
+  if (fragmentShader) {
+    VRB_GL_CHECK(glDeleteShader(fragmentShader));
+  }
+  m.glInitialized = true;
+}
+
+void
+HiddenAreaMask::ShutdownGL() {
+  for (Eye& eye: m.eyes) {
+    if (eye.buffer) {
+      VRB_GL_CHECK(glDeleteBuffers(1, &eye.buffer));
+    }
+    eye.buffer = 0;
+    eye.uploaded = false;
+  }
+  if (m.program) {
+    VRB_GL_CHECK(glDeleteProgram(m.program));
+  }
+  m.program = 0;
+  m.glInitialized = false;
+}
+
+void
+HiddenAreaMask::Draw(const DeviceDelegate::CameraEnum aWhich) {
+  Eye& eye = m.eyes[State::EyeIndex(aWhich)];
+  if (eye.vertices.empty() || !m.program) {
+    return;
+  }
+  CROW_TRACE_SCOPE("HiddenAreaMask::Draw");
+  if (!eye.uploaded) {
+    m.Upload(eye);
+  }
+  VRB_GL_CHECK(glUseProgram(m.program));
+  VRB_GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, eye.buffer));
+  VRB_GL_CHECK(glVertexAttribPointer(kPositionLocation, 2, GL_FLOAT, GL_FALSE, 0, nullptr));
+  VRB_GL_CHECK(glEnableVertexAttribArray(kPositionLocation));
+  // Device meshes do not promise a winding order.
+  const bool cullFace = GLStateCache::IsEnabled(GL_CULL_FACE);
+  GLStateCache::Disable(GL_CULL_FACE);
+  VRB_GL_CHECK(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+  VRB_GL_CHECK(glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(eye.vertices.size() / 2)));
+  VRB_GL_CHECK(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+  if (cullFace) {
+    GLStateCache::Enable(GL_CULL_FACE);
+  }
+  VRB_GL_CHECK(glDisableVertexAttribArray(kPositionLocation));
+  VRB_GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+  VRB_GL_CHECK(glUseProgram(0));
+
+  GLsizei width = 0, height = 0;
+  if (GLStateCache::GetViewportSize(width, height)) {
+    m.maskedPixels += (int64_t)(eye.coverage * (float)width * (float)height);
+  }
+}
+
+float
+HiddenAreaMask::GetCoverage(const DeviceDelegate::CameraEnum aWhich) const {
+  return m.eyes[State::EyeIndex(aWhich)].coverage;
+}
+
+int64_t
+HiddenAreaMask::GetMaskedPixels() const {
+  return m.maskedPixels;
+}
+
+void
+HiddenAreaMask::ResetCounters() {
+  m.maskedPixels = 0;
+}
+
+HiddenAreaMask::HiddenAreaMask(State& aState) : m(aState) {}
+HiddenAreaMask::~HiddenAreaMask() {}
+
+} // namespace crow
@@ -0,0 +1,56 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_HIDDEN_AREA_MASK_DOT_H
+#define VRBROWSER_HIDDEN_AREA_MASK_DOT_H
+
+#include "DeviceDelegate.h"
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+#include <vector>
+
+namespace crow {
+
+class HiddenAreaMask;
+typedef std::shared_ptr<HiddenAreaMask> HiddenAreaMaskPtr;
+
+// Writes the parts of an eye buffer the lenses never show into the depth
+// buffer at the near plane, so early-Z rejects the scene's fragments there.
+// The mesh for each eye is either supplied by the device or built from a lens
+// radius. Draw() must follow the eye clear and precede the scene. Render
+// thread only.
+class HiddenAreaMask {
+public:
+  static HiddenAreaMaskPtr Create();
+  // Triangles as x, y pairs in normalized device coordinates. An empty mesh
+  // disables the mask for that eye.
+  void SetMesh(const DeviceDelegate::CameraEnum aWhich, const std::vector<float>& aVertices);
+  // Builds the same mesh for both eyes from the area outside a circle centered
+  // in the viewport. The radius is relative to half the viewport, so 1.0
+  // touches the edges; values of sqrt(2) or more hide nothing and 0 disables.
+  void SetLensRadius(const float aRadius);
+  bool IsEnabled() const;
+  void InitializeGL();
+  void ShutdownGL();
+  void Draw(const DeviceDelegate::CameraEnum aWhich);
+  // Fraction of the viewport covered by the mesh of the given eye.
+  float GetCoverage(const DeviceDelegate::CameraEnum aWhich) const;
+  // Pixels masked since the last reset.
+  int64_t GetMaskedPixels() const;
+  void ResetCounters();
+protected:
+  struct State;
+  HiddenAreaMask(State& aState);
+  ~HiddenAreaMask();
+private:
+  State& m;
+  HiddenAreaMask() = delete;
+  VRB_NO_DEFAULTS(HiddenAreaMask)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_HIDDEN_AREA_MASK_DOT_H
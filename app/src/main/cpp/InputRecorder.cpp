@@ -0,0 +1,162 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "InputRecorder.h"
+#include "FrameTimings.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/Logger.h"
+#include "vrb/Matrix.h"
+
+#include <cstdio>
+
+namespace crow {
+
+struct InputRecorder::State {
+  ControllerDelegatePtr target;
+  FILE* file;
+  int64_t startTime;
+  State() : file(nullptr), startTime(0) {}
+
+  template <typename T>
+  void Write(const T& aValue) {
+    fwrite(&aValue, sizeof(T), 1, file);
+  }
+
+  void WriteMatrix(const vrb::Matrix& aMatrix) {
+    fwrite(aMatrix.Data(), sizeof(float), 16, file);
+  }
+
+  bool Begin(const InputRecord aRecord, const int32_t aControllerIndex) {
+    if (!file) {
+      return false;
+    }
+    Write(aRecord);
+    Write(aControllerIndex);
+    return true;
+  }
+};
+
+InputRecorderPtr
+InputRecorder::Create(const ControllerDelegatePtr& aTarget) {
+  InputRecorderPtr result = std::make_shared<vrb::ConcreteClass<InputRecorder, InputRecorder::State> >();
+  result->m.target = aTarget;
+  return result;
+}
+
+bool
+InputRecorder::Open(const std::string& aPath) {
+  Close();
+  m.file = fopen(aPath.c_str(), "wb");
+  if (!m.file) {
+    VRB_LOG("Unable to open input recording: %s", aPath.c_str());
+    return false;
+  }
+  m.Write(kInputLogMagic);
+  m.Write(kInputLogVersion);
+  m.startTime = FrameTimings::Now();
+  VRB_LOG("Recording input to: %s", aPath.c_str());
+  return true;
+}
+
+void
+InputRecorder::Close() {
+  if (m.file) {
+    fclose(m.file);
+    m.file = nullptr;
+  }
+}
+
+bool
+InputRecorder::IsOpen() const {
+  return m.file != nullptr;
+}
+
+void
+InputRecorder::RecordFrame(const vrb::Matrix& aHeadTransform) {
+  if (!m.file) {
+    return;
+  }
+  m.Write(InputRecord::Frame);
+  m.Write(FrameTimings::Now() - m.startTime);
+  m.WriteMatrix(aHeadTransform);
+}
+
+void
+InputRecorder::CreateController(const int32_t aControllerIndex, const int32_t aModelIndex) {
+  if (m.Begin(InputRecord::CreateController, aControllerIndex)) {
+    m.Write(aModelIndex);
+  }
+  m.target->CreateController(aControllerIndex, aModelIndex);
+}
+
+void
+InputRecorder::DestroyController(const int32_t aControllerIndex) {
+  m.Begin(InputRecord::DestroyController, aControllerIndex);
+  m.target->DestroyController(aControllerIndex);
+}
+
+void
+InputRecorder::SetEnabled(const int32_t aControllerIndex, const bool aEnabled) {
+  if (m.Begin(InputRecord::SetEnabled, aControllerIndex)) {
+    m.Write((uint8_t)aEnabled);
+  }
+  m.target->SetEnabled(aControllerIndex, aEnabled);
+}
+
+void
+InputRecorder::SetVisible(const int32_t aControllerIndex, const bool aVisible) {
+  if (m.Begin(InputRecord::SetVisible, aControllerIndex)) {
+    m.Write((uint8_t)aVisible);
+  }
+  m.target->SetVisible(aControllerIndex, aVisible);
+}
+
+void
+InputRecorder::SetTransform(const int32_t aControllerIndex, const vrb::Matrix& aTransform) {
+  if (m.Begin(InputRecord::SetTransform, aControllerIndex)) {
+    m.WriteMatrix(aTransform);
+  }
+  m.target->SetTransform(aControllerIndex, aTransform);
+}
+
+void
+InputRecorder::SetButtonState(const int32_t aControllerIndex, const int32_t aWhichButton, const bool aPressed) {
+  if (m.Begin(InputRecord::SetButtonState, aControllerIndex)) {
+    m.Write(aWhichButton);
+    m.Write((uint8_t)aPressed);
+  }
+  m.target->SetButtonState(aControllerIndex, aWhichButton, aPressed);
+}
+
+void
+InputRecorder::SetTouchPosition(const int32_t aControllerIndex, const float aTouchX, const float aTouchY) {
+  if (m.Begin(InputRecord::SetTouchPosition, aControllerIndex)) {
+    m.Write(aTouchX);
+    m.Write(aTouchY);
+  }
+  m.target->SetTouchPosition(aControllerIndex, aTouchX, aTouchY);
+}
+
+void
+InputRecorder::EndTouch(const int32_t aControllerIndex) {
+  m.Begin(InputRecord::EndTouch, aControllerIndex);
+  m.target->EndTouch(aControllerIndex);
+}
+
+void
+InputRecorder::SetScrolledDelta(const int32_t aControllerIndex, const float aScrollDeltaX, const float aScrollDeltaY) {
+  if (m.Begin(InputRecord::SetScrolledDelta, aControllerIndex)) {
+    m.Write(aScrollDeltaX);
+    m.Write(aScrollDeltaY);
+  }
+  m.target->SetScrolledDelta(aControllerIndex, aScrollDeltaX, aScrollDeltaY);
+}
+
+InputRecorder::InputRecorder(State& aState) : m(aState) {}
+InputRecorder::~InputRecorder() {
+  Close();
+}
+
+} // namespace crow
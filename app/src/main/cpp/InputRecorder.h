@@ -0,0 +1,73 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_INPUT_RECORDER_DOT_H
+#define VRBROWSER_INPUT_RECORDER_DOT_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+#include "ControllerDelegate.h"
+
+#include <memory>
+#include <string>
+
+namespace crow {
+
+class InputRecorder;
+typedef std::shared_ptr<InputRecorder> InputRecorderPtr;
+
+// Binary input log layout. The file starts with kInputLogMagic and
+// kInputLogVersion as little endian uint32 values, followed by records that
+// each begin with a one byte InputRecord tag. Controller records carry an
+// int32 controller index. Every controller call made while the device
+// processed events for a frame precedes that frame's Frame record.
+static const uint32_t kInputLogMagic = 0x49425256; // "VRBI"
+static const uint32_t kInputLogVersion = 1;
+
+enum class InputRecord : uint8_t {
+  Frame = 0, // int64 nanoseconds since recording started, float[16] head transform.
+  CreateController, // int32 model index.
+  DestroyController,
+  SetEnabled, // uint8 enabled.
+  SetVisible, // uint8 visible.
+  SetTransform, // float[16] transform.
+  SetButtonState, // int32 button, uint8 pressed.
+  SetTouchPosition, // float x, float y.
+  EndTouch,
+  SetScrolledDelta // float x, float y.
+};
+
+// Forwards every ControllerDelegate call to the wrapped delegate and appends it
+// to an input log, so a session can later be replayed by InputReplayer.
+class InputRecorder : public ControllerDelegate {
+public:
+  static InputRecorderPtr Create(const ControllerDelegatePtr& aTarget);
+  bool Open(const std::string& aPath);
+  void Close();
+  bool IsOpen() const;
+  void RecordFrame(const vrb::Matrix& aHeadTransform);
+  // crow::ControllerDelegate interface
+  void CreateController(const int32_t aControllerIndex, const int32_t aModelIndex) override;
+  void DestroyController(const int32_t aControllerIndex) override;
+  void SetEnabled(const int32_t aControllerIndex, const bool aEnabled) override;
+  void SetVisible(const int32_t aControllerIndex, const bool aVisible) override;
+  void SetTransform(const int32_t aControllerIndex, const vrb::Matrix& aTransform) override;
+  void SetButtonState(const int32_t aControllerIndex, const int32_t aWhichButton, const bool aPressed) override;
+  void SetTouchPosition(const int32_t aControllerIndex, const float aTouchX, const float aTouchY) override;
+  void EndTouch(const int32_t aControllerIndex) override;
+  void SetScrolledDelta(const int32_t aControllerIndex, const float aScrollDeltaX, const float aScrollDeltaY) override;
+protected:
+  struct State;
+  InputRecorder(State& aState);
+  ~InputRecorder();
+private:
+  State& m;
+  InputRecorder() = delete;
+  VRB_NO_DEFAULTS(InputRecorder)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_INPUT_RECORDER_DOT_H
@@ -0,0 +1,217 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "InputReplayer.h"
+#include "InputRecorder.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/Logger.h"
+#include "vrb/Matrix.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace crow {
+
+namespace {
+
+class NullController : public ControllerDelegate {
+public:
+  NullController() {}
+  void CreateController(const int32_t, const int32_t) override {}
+  void DestroyController(const int32_t) override {}
+  void SetEnabled(const int32_t, const bool) override {}
+  void SetVisible(const int32_t, const bool) override {}
+  void SetTransform(const int32_t, const vrb::Matrix&) override {}
+  void SetButtonState(const int32_t, const int32_t, const bool) override {}
+  void SetTouchPosition(const int32_t, const float, const float) override {}
+  void EndTouch(const int32_t) override {}
+  void SetScrolledDelta(const int32_t, const float, const float) override {}
+};
+
+} // namespace
+
+struct InputReplayer::State {
+  std::vector<uint8_t> data;
+  size_t offset;
+  size_t start;
+  int32_t frameCount;
+  bool finished;
+  State() : offset(0), start(0), frameCount(0), finished(true) {}
+
+  template <typename T>
+  bool Read(T& aValue) {
+    if ((offset + sizeof(T)) > data.size()) {
+      return false;
+    }
+    memcpy(&aValue, &data[offset], sizeof(T));
+    offset += sizeof(T);
+    return true;
+  }
+
+  bool ReadMatrix(vrb::Matrix& aMatrix) {
+    const size_t size = sizeof(float) * 16;
+    if ((offset + size) > data.size()) {
+      return false;
+    }
+    memcpy(aMatrix.Data(), &data[offset], size);
+    offset += size;
+    return true;
+  }
+
+  bool ReadBool(bool& aValue) {
+    uint8_t value = 0;
+    if (!Read(value)) {
+      return false;
+    }
+    aValue = value != 0;
+    return true;
+  }
+};
+
+InputReplayerPtr
+InputReplayer::Create() {
+  return std::make_shared<vrb::ConcreteClass<InputReplayer, InputReplayer::State> >();
+}
+
+bool
+InputReplayer::Open(const std::string& aPath) {
+  m.data.clear();
+  m.frameCount = 0;
+  m.finished = true;
+  FILE* file = fopen(aPath.c_str(), "rb");
+  if (!file) {
+    VRB_LOG("Unable to open input recording: %s", aPath.c_str());
+    return false;
+  }
+  uint8_t buffer[4096];
+  size_t count = 0;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    m.data.insert(m.data.end(), buffer, buffer + count);
+  }
+  fclose(file);
+
+  m.offset = 0;
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  if (!m.Read(magic) || !m.Read(version) || (magic != kInputLogMagic) || (version != kInputLogVersion)) {
+    VRB_LOG("Invalid input recording: %s", aPath.c_str());
+    m.data.clear();
+    return false;
+  }
+  m.start = m.offset;
+
+  // Count the frames up front so callers know how long the replay runs.
+  NullController counter;
+  vrb::Matrix head = vrb::Matrix::Identity();
+  m.finished = false;
+  while (PlayFrame(counter, head)) {
+    m.frameCount++;
+  }
+  Rewind();
+  VRB_LOG("Loaded %d frames of input from: %s", m.frameCount, aPath.c_str());
+  return true;
+}
+
+int32_t
+InputReplayer::GetFrameCount() const {
+  return m.frameCount;
+}
+
+bool
+InputReplayer::IsFinished() const {
+  return m.finished;
+}
+
+void
+InputReplayer::Rewind() {
+  m.offset = m.start;
+  m.finished = m.data.empty();
+}
+
+bool
+InputReplayer::PlayFrame(ControllerDelegate& aDelegate, vrb::Matrix& aHeadTransform) {
+  while (!m.finished) {
+    InputRecord record;
+    if (!m.Read(record)) {
+      m.finished = true;
+      break;
+    }
+    if (record == InputRecord::Frame) {
+      int64_t timestamp = 0;
+      if (m.Read(timestamp) && m.ReadMatrix(aHeadTransform)) {
+        return true;
+      }
+      m.finished = true;
+      break;
+    }
+    int32_t index = 0;
+    bool valid = m.Read(index);
+    switch (record) {
+      case InputRecord::CreateController: {
+        int32_t model = 0;
+        valid = valid && m.Read(model);
+        if (valid) { aDelegate.CreateController(index, model); }
+        break;
+      }
+      case InputRecord::DestroyController:
+        if (valid) { aDelegate.DestroyController(index); }
+        break;
+      case InputRecord::SetEnabled: {
+        bool enabled = false;
+        valid = valid && m.ReadBool(enabled);
+        if (valid) { aDelegate.SetEnabled(index, enabled); }
+        break;
+      }
+      case InputRecord::SetVisible: {
+        bool visible = false;
+        valid = valid && m.ReadBool(visible);
+        if (valid) { aDelegate.SetVisible(index, visible); }
+        break;
+      }
+      case InputRecord::SetTransform: {
+        vrb::Matrix transform;
+        valid = valid && m.ReadMatrix(transform);
+        if (valid) { aDelegate.SetTransform(index, transform); }
+        break;
+      }
+      case InputRecord::SetButtonState: {
+        int32_t button = 0;
+        bool pressed = false;
+        valid = valid && m.Read(button) && m.ReadBool(pressed);
+        if (valid) { aDelegate.SetButtonState(index, button, pressed); }
+        break;
+      }
+      case InputRecord::SetTouchPosition: {
+        float x = 0.0f, y = 0.0f;
+        valid = valid && m.Read(x) && m.Read(y);
+        if (valid) { aDelegate.SetTouchPosition(index, x, y); }
+        break;
+      }
+      case InputRecord::EndTouch:
+        if (valid) { aDelegate.EndTouch(index); }
+        break;
+      case InputRecord::SetScrolledDelta: {
+        float x = 0.0f, y = 0.0f;
+        valid = valid && m.Read(x) && m.Read(y);
+        if (valid) { aDelegate.SetScrolledDelta(index, x, y); }
+        break;
+      }
+      default:
+        valid = false;
+        break;
+    }
+    if (!valid) {
+      VRB_LOG("Corrupt input recording at offset: %zu", m.offset);
+      m.finished = true;
+    }
+  }
+  return false;
+}
+
+InputReplayer::InputReplayer(State& aState) : m(aState) {}
+InputReplayer::~InputReplayer() {}
+
+} // namespace crow
@@ -0,0 +1,45 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_INPUT_REPLAYER_DOT_H
+#define VRBROWSER_INPUT_REPLAYER_DOT_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+#include "ControllerDelegate.h"
+
+#include <memory>
+#include <string>
+
+namespace crow {
+
+class InputReplayer;
+typedef std::shared_ptr<InputReplayer> InputReplayerPtr;
+
+// Plays back a log written by InputRecorder one frame at a time.
+class InputReplayer {
+public:
+  static InputReplayerPtr Create();
+  bool Open(const std::string& aPath);
+  int32_t GetFrameCount() const;
+  bool IsFinished() const;
+  void Rewind();
+  // Issues the controller calls recorded for the next frame on aDelegate and
+  // returns the head transform recorded for it. Returns false once the log is
+  // exhausted or corrupt.
+  bool PlayFrame(ControllerDelegate& aDelegate, vrb::Matrix& aHeadTransform);
+protected:
+  struct State;
+  InputReplayer(State& aState);
+  ~InputReplayer();
+private:
+  State& m;
+  InputReplayer() = delete;
+  VRB_NO_DEFAULTS(InputReplayer)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_INPUT_REPLAYER_DOT_H
@@ -0,0 +1,117 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "ResolutionGovernor.h"
+#include "FrameHistogram.h"
+#include "GovernorHysteresis.h"
+#include "Trace.h"
+#include "vrb/ConcreteClass.h"
+
+#include <algorithm>
+
+namespace crow {
+
+namespace {
+
+const float kDefaultMinScale = 0.6f;
+const float kDefaultMaxScale = 1.0f;
+const float kStepDown = 0.1f;
+const float kStepUp = 0.05f;
+// CPU time as a fraction of the display period. Between the two the scale
+// is left alone.
+const float kHighLoad = 0.9f;
+const float kLowLoad = 0.7f;
+// Frames under budget needed before stepping up. See GovernorHysteresis.
+const int32_t kMinHoldFrames = 60;
+const int32_t kMaxHoldFrames = 960;
+
+} // namespace
+
+struct ResolutionGovernor::State {
+  float minScale;
+  float maxScale;
+  float scale;
+  bool enabled;
+  bool measured;
+  float load;
+  GovernorHysteresis hysteresis;
+
+  State()
+      : minScale(kDefaultMinScale)
+      , maxScale(kDefaultMaxScale)
+      , scale(kDefaultMaxScale)
+      , enabled(true)
+      , measured(false)
+      , load(0.0f)
+      , hysteresis(kMinHoldFrames, kMaxHoldFrames)
+  {}
+
+  float Clamp(const float aScale) const {
+    return std::max(minScale, std::min(maxScale, aScale));
+  }
+};
+
+ResolutionGovernorPtr
+ResolutionGovernor::Create() {
+  return std::make_shared<vrb::ConcreteClass<ResolutionGovernor, ResolutionGovernor::State> >();
+}
+
+void
+ResolutionGovernor::SetRange(const float aMinScale, const float aMaxScale) {
+  m.maxScale = std::max(0.1f, std::min(1.0f, aMaxScale));
+  m.minScale = std::max(0.1f, std::min(m.maxScale, aMinScale));
+  m.scale = m.Clamp(m.scale);
+}
+
+void
+ResolutionGovernor::SetEnabled(const bool aEnabled) {
+  m.enabled = aEnabled;
+  if (!aEnabled) {
+    m.scale = m.maxScale;
+    m.measured = false;
+    m.hysteresis.Reset();
+  }
+}
+
+bool
+ResolutionGovernor::IsEnabled() const {
+  return m.enabled;
+}
+
+bool
+ResolutionGovernor::Update(const int64_t aCPUTime, const int64_t aFrameInterval, const float aDisplayPeriod) {
+  if (!m.enabled || (aDisplayPeriod <= 0.0f)) {
+    return false;
+  }
+  const float load = (float)aCPUTime / (aDisplayPeriod * 1.0e9f);
+  m.load = m.measured ? (m.load * 0.75f + load * 0.25f) : load;
+  m.measured = true;
+  const GovernorHysteresis::Decision decision =
+      m.hysteresis.Update(FrameHistogram::IsMissedFrame(aFrameInterval, aDisplayPeriod),
+                          m.load > kHighLoad, m.load < kLowLoad);
+  float target = m.scale;
+  if (decision == GovernorHysteresis::Decision::Relieve) {
+    target = m.Clamp(m.scale - kStepDown);
+  } else if (decision == GovernorHysteresis::Decision::Load) {
+    target = m.Clamp(m.scale + kStepUp);
+  }
+  if (target == m.scale) {
+    return false;
+  }
+  m.hysteresis.Applied(decision);
+  m.scale = target;
+  CROW_TRACE_COUNTER("RenderScale", m.scale);
+  return true;
+}
+
+float
+ResolutionGovernor::GetScale() const {
+  return m.scale;
+}
+
+ResolutionGovernor::ResolutionGovernor(State& aState) : m(aState) {}
+ResolutionGovernor::~ResolutionGovernor() {}
+
+} // namespace crow
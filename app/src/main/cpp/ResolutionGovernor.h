@@ -0,0 +1,46 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_RESOLUTION_GOVERNOR_DOT_H
+#define VRBROWSER_RESOLUTION_GOVERNOR_DOT_H
+
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+
+namespace crow {
+
+class ResolutionGovernor;
+typedef std::shared_ptr<ResolutionGovernor> ResolutionGovernorPtr;
+
+// Picks the fraction of the allocated eye buffers to render into from recent
+// frame costs. The CPU time of a frame is measured directly. GPU time is not
+// visible without timer queries, so the frame interval stands in for it: the
+// runtime blocks submission while the GPU is behind. The scale drops quickly
+// when frames run over budget or miss vsync and climbs back slowly once they
+// have been comfortably under budget for a while. Render thread only.
+class ResolutionGovernor {
+public:
+  static ResolutionGovernorPtr Create();
+  // Scales are linear, per axis, relative to the allocated eye buffer.
+  void SetRange(const float aMinScale, const float aMaxScale);
+  void SetEnabled(const bool aEnabled);
+  bool IsEnabled() const;
+  // Returns true if the scale changed.
+  bool Update(const int64_t aCPUTime, const int64_t aFrameInterval, const float aDisplayPeriod);
+  float GetScale() const;
+protected:
+  struct State;
+  ResolutionGovernor(State& aState);
+  ~ResolutionGovernor();
+private:
+  State& m;
+  ResolutionGovernor() = delete;
+  VRB_NO_DEFAULTS(ResolutionGovernor)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_RESOLUTION_GOVERNOR_DOT_H
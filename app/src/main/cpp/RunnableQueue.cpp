@@ -0,0 +1,244 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "RunnableQueue.h"
+#include "FrameTimings.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/Logger.h"
+
+#include <atomic>
+
+namespace crow {
+
+namespace {
+
+struct Node {
+  std::atomic<Node*> next;
+  std::function<void()> task;
+  jobject runnable; // Global reference, null for native tasks.
+  int64_t queued;
+
+  Node() : next(nullptr), runnable(nullptr), queued(0) {}
+};
+
+} // namespace
+
+// Intrusive MPSC queue after Dmitry Vyukov. Producers swap themselves in at
+// head with a single exchange; the consumer follows next links from tail. A
+// producer that has swapped head but not yet linked next makes the queue
+// look empty for a moment, in which case the rest is picked up next frame.
+struct RunnableQueue::State {
+  JavaVM* vm;
+  jmethodID runMethod;
+  std::atomic<Node*> head;
+  Node* tail;
+  Node stub;
+  std::atomic<int32_t> depth;
+  std::atomic<int32_t> maxDepth;
+  std::atomic<int32_t> processed;
+  std::atomic<int32_t> deferred;
+  std::atomic<int64_t> maxLatency;
+  std::atomic<int64_t> totalLatency;
+
+  State()
+      : vm(nullptr)
+      , runMethod(nullptr)
+      , head(&stub)
+      , tail(&stub)
+      , depth(0)
+      , maxDepth(0)
+      , processed(0)
+      , deferred(0)
+      , maxLatency(0)
+      , totalLatency(0)
+  {}
+
+  ~State() {
+    JNIEnv* env = GetEnv();
+    while (Node* node = Pop()) {
+      if (env && node->runnable) {
+        env->DeleteGlobalRef(node->runnable);
+      }
+      delete node;
+    }
+  }
+
+  JNIEnv* GetEnv() const {
+    JNIEnv* env = nullptr;
+    if (!vm || (vm->GetEnv((void**)&env, JNI_VERSION_1_6) != JNI_OK)) {
+      return nullptr;
+    }
+    return env;
+  }
+
+  void Push(Node* aNode) {
+    aNode->next.store(nullptr, std::memory_order_relaxed);
+    Node* previous = head.exchange(aNode, std::memory_order_acq_rel);
+    previous->next.store(aNode, std::memory_order_release);
+  }
+
+  void Enqueue(Node* aNode) {
+    aNode->queued = FrameTimings::Now();
+    // Counted before the push so the consumer never sees a negative depth.
+    const int32_t current = depth.fetch_add(1, std::memory_order_relaxed) + 1;
+    Push(aNode);
+    int32_t deepest = maxDepth.load(std::memory_order_relaxed);
+    while ((current > deepest) &&
+           !maxDepth.compare_exchange_weak(deepest, current, std::memory_order_relaxed)) {}
+  }
+
+  // Consumer only.
+  Node* Pop() {
+    Node* first = tail;
+    Node* next = first->next.load(std::memory_order_acquire);
+    if (first == &stub) {
+      if (!next) {
+        return nullptr;
+      }
+      tail = next;
+      first = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next) {
+      tail = next;
+      return first;
+    }
+    if (first != head.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    Push(&stub);
+    next = first->next.load(std::memory_order_acquire);
+    if (next) {
+      tail = next;
+      return first;
+    }
+    return nullptr;
+  }
+
+  void Run(JNIEnv* aEnv, Node* aNode) {
+    if (aNode->runnable) {
+      if (aEnv && runMethod) {
+        aEnv->CallVoidMethod(aNode->runnable, runMethod);
+        if (aEnv->ExceptionCheck()) {
+          VRB_LOG("RunnableQueue: Java Runnable threw an exception");
+          aEnv->ExceptionDescribe();
+          aEnv->ExceptionClear();
+        }
+      }
+      if (aEnv) {
+        aEnv->DeleteGlobalRef(aNode->runnable);
+      }
+    } else if (aNode->task) {
+      aNode->task();
+    }
+  }
+};
+
+const int64_t RunnableQueue::kNoBudget;
+
+RunnableQueuePtr
+RunnableQueue::Create(JavaVM* aVM) {
+  RunnableQueuePtr result = std::make_shared<vrb::ConcreteClass<RunnableQueue, RunnableQueue::State> >();
+  result->m.vm = aVM;
+  JNIEnv* env = result->m.GetEnv();
+  if (env) {
+    jclass clazz = env->FindClass("java/lang/Runnable");
+    if (clazz) {
+      result->m.runMethod = env->GetMethodID(clazz, "run", "()V");
+      env->DeleteLocalRef(clazz);
+    }
+    if (!result->m.runMethod) {
+      VRB_LOG("Failed to find Java method: Runnable.run ()V");
+      env->ExceptionClear();
+    }
+  }
+  return result;
+}
+
+void
+RunnableQueue::AddRunnable(JNIEnv* aEnv, jobject aRunnable) {
+  if (!aEnv || !aRunnable) {
+    return;
+  }
+  Node* node = new Node;
+  node->runnable = aEnv->NewGlobalRef(aRunnable);
+  m.Enqueue(node);
+}
+
+void
+RunnableQueue::AddTask(std::function<void()>&& aTask) {
+  if (!aTask) {
+    return;
+  }
+  Node* node = new Node;
+  node->task = std::move(aTask);
+  m.Enqueue(node);
+}
+
+int32_t
+RunnableQueue::ProcessRunnables(const int64_t aBudget) {
+  JNIEnv* env = nullptr;
+  const int64_t start = FrameTimings::Now();
+  int64_t now = start;
+  int32_t count = 0;
+  int64_t maxLatency = 0;
+  int64_t totalLatency = 0;
+  while (Node* node = m.Pop()) {
+    if (node->runnable && !env) {
+      env = m.GetEnv();
+    }
+    const int64_t latency = now - node->queued;
+    maxLatency = latency > maxLatency ? latency : maxLatency;
+    totalLatency += latency;
+    m.depth.fetch_sub(1, std::memory_order_relaxed);
+    m.Run(env, node);
+    delete node;
+    count++;
+    now = FrameTimings::Now();
+    if ((aBudget >= 0) && ((now - start) >= aBudget)) {
+      if (m.depth.load(std::memory_order_relaxed) > 0) {
+        m.deferred.fetch_add(1, std::memory_order_relaxed);
+      }
+      break;
+    }
+  }
+  if (count > 0) {
+    m.processed.fetch_add(count, std::memory_order_relaxed);
+    m.totalLatency.fetch_add(totalLatency, std::memory_order_relaxed);
+    int64_t previous = m.maxLatency.load(std::memory_order_relaxed);
+    while ((maxLatency > previous) &&
+           !m.maxLatency.compare_exchange_weak(previous, maxLatency, std::memory_order_relaxed)) {}
+  }
+  return count;
+}
+
+int32_t
+RunnableQueue::GetDepth() const {
+  return m.depth.load(std::memory_order_relaxed);
+}
+
+void
+RunnableQueue::GetStats(Stats& aStats) const {
+  aStats.depth = m.depth.load(std::memory_order_relaxed);
+  aStats.maxDepth = m.maxDepth.load(std::memory_order_relaxed);
+  aStats.processed = m.processed.load(std::memory_order_relaxed);
+  aStats.deferred = m.deferred.load(std::memory_order_relaxed);
+  aStats.maxLatency = m.maxLatency.load(std::memory_order_relaxed);
+  aStats.totalLatency = m.totalLatency.load(std::memory_order_relaxed);
+}
+
+void
+RunnableQueue::ResetStats() {
+  m.maxDepth.store(m.depth.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  m.processed.store(0, std::memory_order_relaxed);
+  m.deferred.store(0, std::memory_order_relaxed);
+  m.maxLatency.store(0, std::memory_order_relaxed);
+  m.totalLatency.store(0, std::memory_order_relaxed);
+}
+
+RunnableQueue::RunnableQueue(State& aState) : m(aState) {}
+RunnableQueue::~RunnableQueue() {}
+
+} // namespace crow
@@ -0,0 +1,58 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_RUNNABLE_QUEUE_DOT_H
+#define VRBROWSER_RUNNABLE_QUEUE_DOT_H
+
+#include "vrb/MacroUtils.h"
+
+#include <functional>
+#include <memory>
+#include <jni.h>
+
+namespace crow {
+
+class RunnableQueue;
+typedef std::shared_ptr<RunnableQueue> RunnableQueuePtr;
+
+// Multi-producer, single-consumer queue of work for the render thread. Any
+// thread may add Java Runnables or native tasks without taking a lock; only
+// the render thread calls ProcessRunnables(). Native tasks do not touch JNI.
+class RunnableQueue {
+public:
+  struct Stats {
+    int32_t depth;        // Tasks waiting when the stats were read.
+    int32_t maxDepth;     // Deepest the queue has been since the last reset.
+    int32_t processed;    // Tasks run since the last reset.
+    int32_t deferred;     // Times ProcessRunnables() ran out of budget with work left.
+    int64_t maxLatency;   // Nanoseconds from AddRunnable()/AddTask() to run.
+    int64_t totalLatency; // Nanoseconds, divide by processed for the mean.
+  };
+  // Used by ProcessRunnables() to drain everything that is queued.
+  static const int64_t kNoBudget = -1;
+
+  static RunnableQueuePtr Create(JavaVM* aVM);
+  void AddRunnable(JNIEnv* aEnv, jobject aRunnable);
+  void AddTask(std::function<void()>&& aTask);
+  // Runs queued work in order until the queue is empty or aBudget nanoseconds
+  // have passed. At least one task runs per call so the queue always drains.
+  // Returns the number of tasks run.
+  int32_t ProcessRunnables(const int64_t aBudget = kNoBudget);
+  int32_t GetDepth() const;
+  void GetStats(Stats& aStats) const;
+  void ResetStats();
+protected:
+  struct State;
+  RunnableQueue(State& aState);
+  ~RunnableQueue();
+private:
+  State& m;
+  RunnableQueue() = delete;
+  VRB_NO_DEFAULTS(RunnableQueue)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_RUNNABLE_QUEUE_DOT_H
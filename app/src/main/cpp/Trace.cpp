@@ -0,0 +1,241 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "Trace.h"
+#include "FrameTimings.h"
+#include "vrb/Logger.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace crow {
+
+namespace {
+
+const size_t kEventsPerThread = 32768;
+
+struct Event {
+  const char* name;
+  char phase; // 'X' complete span, 'C' counter or 'i' instant.
+  int64_t timestamp;
+  int64_t duration;
+  double value;
+};
+
+// Bumped by Trace::Start(). A buffer whose generation is behind holds events
+// from an earlier recording.
+std::atomic<uint32_t> sGeneration(0);
+
+// Only the owning thread writes to a buffer, including resetting it when a new
+// recording starts. The events are allocated by the first event recorded, so
+// threads that never trace while recording is on cost no more than this
+// struct. Once the buffer wraps, the oldest events are overwritten.
+struct ThreadBuffer {
+  int32_t tid;
+  std::string name; // Guarded by sBuffersLock.
+  bool exited; // Guarded by sBuffersLock.
+  std::vector<Event> events;
+  std::atomic<uint64_t> count;
+  std::atomic<uint32_t> generation;
+  // Set while the owner is inside Add() so Trace::Write() can wait for it.
+  std::atomic<bool> busy;
+  ThreadBuffer(const std::string& aName)
+      : tid((int32_t)syscall(SYS_gettid))
+      , name(aName)
+      , exited(false)
+      , count(0)
+      , generation(sGeneration.load(std::memory_order_acquire))
+      , busy(false) {}
+
+  // aEnabled is Trace::sEnabled. Both it and busy are accessed sequentially
+  // consistent here and in Trace::Stop() and Trace::Write(): either the event
+  // is dropped here or Write() sees the buffer busy and waits. The relaxed
+  // Trace::IsEnabled() is only a fast path for callers.
+  void Add(const std::atomic<bool>& aEnabled, const Event& aEvent) {
+    busy.store(true);
+    if (!aEnabled.load()) {
+      busy.store(false, std::memory_order_release);
+      return;
+    }
+    const uint32_t current = sGeneration.load(std::memory_order_acquire);
+    if (generation.load(std::memory_order_relaxed) != current) {
+      count.store(0, std::memory_order_relaxed);
+      generation.store(current, std::memory_order_relaxed);
+    }
+    if (events.empty()) {
+      events.resize(kEventsPerThread);
+    }
+    const uint64_t index = count.load(std::memory_order_relaxed);
+    events[index % kEventsPerThread] = aEvent;
+    count.store(index + 1, std::memory_order_relaxed);
+    busy.store(false, std::memory_order_release);
+  }
+};
+
+typedef std::shared_ptr<ThreadBuffer> ThreadBufferPtr;
+
+std::mutex sBuffersLock;
+std::vector<ThreadBufferPtr> sBuffers;
+int64_t sStartTime = 0;
+
+// The calling thread's name and buffer. The buffer is created by the first
+// event the thread records and is dropped from sBuffers by the first
+// Trace::Start() after the thread exits, so its last events can still be
+// written until then.
+struct ThreadState {
+  std::string name;
+  ThreadBufferPtr buffer;
+  ~ThreadState() {
+    if (buffer) {
+      std::lock_guard<std::mutex> lock(sBuffersLock);
+      buffer->exited = true;
+    }
+  }
+};
+
+thread_local ThreadState tThread;
+
+ThreadBuffer&
+GetThreadBuffer() {
+  if (!tThread.buffer) {
+    std::lock_guard<std::mutex> lock(sBuffersLock);
+    tThread.buffer = std::make_shared<ThreadBuffer>(tThread.name);
+    sBuffers.push_back(tThread.buffer);
+  }
+  return *tThread.buffer;
+}
+
+void
+WriteEscaped(FILE* aFile, const char* aText) {
+  for (const char* ch = aText; *ch; ch++) {
+    if ((*ch == '"') || (*ch == '\\')) {
+      fputc('\\', aFile);
+    }
+    fputc(*ch, aFile);
+  }
+}
+
+} // namespace
+
+std::atomic<bool> Trace::sEnabled(false);
+
+void
+Trace::Start() {
+  {
+    std::lock_guard<std::mutex> lock(sBuffersLock);
+    sBuffers.erase(std::remove_if(sBuffers.begin(), sBuffers.end(),
+                                  [](const ThreadBufferPtr& aBuffer) { return aBuffer->exited; }),
+                   sBuffers.end());
+    sStartTime = FrameTimings::Now();
+    sGeneration.fetch_add(1, std::memory_order_release);
+    sEnabled.store(true);
+  }
+  VRB_LOG("Native tracing started");
+}
+
+void
+Trace::Stop() {
+  sEnabled.store(false);
+  VRB_LOG("Native tracing stopped");
+}
+
+bool
+Trace::Write(const std::string& aPath) {
+  std::lock_guard<std::mutex> lock(sBuffersLock);
+  if (sEnabled.load()) {
+    VRB_LOG("Unable to write native trace while recording");
+    return false;
+  }
+  FILE* file = fopen(aPath.c_str(), "w");
+  if (!file) {
+    VRB_LOG("Unable to open trace file: %s", aPath.c_str());
+    return false;
+  }
+  const int pid = (int)getpid();
+  bool first = true;
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  const uint32_t current = sGeneration.load(std::memory_order_acquire);
+  for (const ThreadBufferPtr& buffer: sBuffers) {
+    if (!buffer->name.empty()) {
+      fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"",
+              first ? "" : ",", pid, buffer->tid);
+      WriteEscaped(file, buffer->name.c_str());
+      fprintf(file, "\"}}");
+      first = false;
+    }
+    // A thread that recorded an event just before Stop() may still be
+    // storing it.
+    while (buffer->busy.load()) {
+      sched_yield();
+    }
+    if (buffer->generation.load(std::memory_order_relaxed) != current) {
+      continue;
+    }
+    const uint64_t count = buffer->count.load(std::memory_order_relaxed);
+    const uint64_t begin = count > kEventsPerThread ? count - kEventsPerThread : 0;
+    for (uint64_t index = begin; index < count; index++) {
+      const Event& event = buffer->events[index % kEventsPerThread];
+      // Chrome trace timestamps are in microseconds.
+      const double timestamp = (double)(event.timestamp - sStartTime) / 1000.0;
+      fprintf(file, "%s\n{\"name\":\"", first ? "" : ",");
+      WriteEscaped(file, event.name);
+      fprintf(file, "\",\"ph\":\"%c\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f", event.phase, pid, buffer->tid, timestamp);
+      if (event.phase == 'X') {
+        fprintf(file, ",\"dur\":%.3f", (double)event.duration / 1000.0);
+      } else if (event.phase == 'C') {
+        fprintf(file, ",\"args\":{\"value\":%g}", event.value);
+      } else if (event.phase == 'i') {
+        fprintf(file, ",\"s\":\"t\"");
+      }
+      fprintf(file, "}");
+      first = false;
+    }
+  }
+  fprintf(file, "\n]}\n");
+  fclose(file);
+  VRB_LOG("Wrote native trace to: %s", aPath.c_str());
+  return true;
+}
+
+void
+Trace::SetThreadName(const char* aName) {
+  tThread.name = aName;
+  if (tThread.buffer) {
+    std::lock_guard<std::mutex> lock(sBuffersLock);
+    tThread.buffer->name = aName;
+  }
+}
+
+void
+Trace::Complete(const char* aName, const int64_t aStart, const int64_t aEnd) {
+  GetThreadBuffer().Add(sEnabled, {aName, 'X', aStart, aEnd - aStart, 0.0});
+}
+
+void
+Trace::Counter(const char* aName, const double aValue) {
+  GetThreadBuffer().Add(sEnabled, {aName, 'C', FrameTimings::Now(), 0, aValue});
+}
+
+void
+Trace::Instant(const char* aName) {
+  GetThreadBuffer().Add(sEnabled, {aName, 'i', FrameTimings::Now(), 0, 0.0});
+}
+
+Trace::Scope::Scope(const char* aName)
+    : mName(IsEnabled() ? aName : nullptr), mStart(mName ? FrameTimings::Now() : 0) {}
+
+Trace::Scope::~Scope() {
+  if (mName && IsEnabled()) {
+    Complete(mName, mStart, FrameTimings::Now());
+  }
+}
+
+} // namespace crow
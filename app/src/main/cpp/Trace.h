@@ -0,0 +1,58 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_TRACE_DOT_H
+#define VRBROWSER_TRACE_DOT_H
+
+#include <atomic>
+#include <string>
+
+namespace crow {
+
+// Records spans, counters and instant events into per-thread ring buffers and
+// writes them out as Chrome trace-event JSON, which can be loaded in
+// chrome://tracing or ui.perfetto.dev. Event names must be string literals
+// since only the pointer is stored. Recording is off until Trace::Start(), and
+// Trace::Write() fails unless recording has been stopped with Trace::Stop().
+class Trace {
+public:
+  static bool IsEnabled() {
+    return sEnabled.load(std::memory_order_relaxed);
+  }
+  static void Start();
+  static void Stop();
+  static bool Write(const std::string& aPath);
+  static void SetThreadName(const char* aName);
+  static void Complete(const char* aName, const int64_t aStart, const int64_t aEnd);
+  static void Counter(const char* aName, const double aValue);
+  static void Instant(const char* aName);
+
+  class Scope {
+  public:
+    Scope(const char* aName);
+    ~Scope();
+  private:
+    const char* mName;
+    int64_t mStart;
+    Scope() = delete;
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+  };
+private:
+  static std::atomic<bool> sEnabled;
+  Trace() = delete;
+};
+
+} // namespace crow
+
+#define CROW_TRACE_CONCAT_INNER(a, b) a##b
+#define CROW_TRACE_CONCAT(a, b) CROW_TRACE_CONCAT_INNER(a, b)
+#define CROW_TRACE_SCOPE(name) crow::Trace::Scope CROW_TRACE_CONCAT(traceScope, __LINE__)(name)
+#define CROW_TRACE_COUNTER(name, value) \
+  if (crow::Trace::IsEnabled()) { crow::Trace::Counter(name, value); }
+#define CROW_TRACE_INSTANT(name) \
+  if (crow::Trace::IsEnabled()) { crow::Trace::Instant(name); }
+
+#endif // VRBROWSER_TRACE_DOT_H
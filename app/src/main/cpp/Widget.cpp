@@ -18,6 +18,8 @@
 #include "vrb/Vector.h"
 #include "vrb/VertexArray.h"
 
+#include <algorithm>
+
 namespace crow {
 
 const float kWidth = 9.0f;
@@ -41,7 +43,16 @@ struct Widget::State {
   vrb::TogglePtr pointerToggle;
   vrb::TransformPtr pointer;
   vrb::NodePtr pointerGeometry;
+  bool visible = true;
+  bool inView = true;
   bool pointerEnabled = true;
+  bool pointerVisible = true;
+  vrb::Vector pointerLocation;
+  vrb::Matrix worldInverse;
+  bool worldInverseDirty = true;
+  vrb::Vector worldMin;
+  vrb::Vector worldMax;
+  bool worldBoundsDirty = true;
 
   State()
       : type(0)
@@ -141,7 +152,44 @@ struct Widget::State {
     pointer->AddNode(geometry);
     pointerToggle = vrb::Toggle::Create(context);
     pointerToggle->AddNode(pointer);
-    transform->AddNode(pointerToggle);
+  }
+
+  // The pointer is not part of the widget's subtree. It is placed in world
+  // space so moving it does not touch the scene graph the widget is in.
+  void UpdatePointer() {
+    pointer->SetTransform(transform->GetWorldTransform().PostMultiply(vrb::Matrix::Position(pointerLocation)));
+  }
+
+  void UpdatePointerToggle() {
+    pointerToggle->ToggleAll(pointerEnabled && pointerVisible && visible && inView);
+  }
+
+  const vrb::Matrix& GetWorldInverse() {
+    if (worldInverseDirty) {
+      worldInverse = transform->GetWorldTransform().AfineInverse();
+      worldInverseDirty = false;
+    }
+    return worldInverse;
+  }
+
+  void UpdateWorldBounds() {
+    if (!worldBoundsDirty) {
+      return;
+    }
+    const vrb::Matrix world = transform->GetWorldTransform();
+    const vrb::Vector corners[] = {
+      windowMin,
+      vrb::Vector(windowMax.x(), windowMin.y(), windowMin.z()),
+      windowMax,
+      vrb::Vector(windowMin.x(), windowMax.y(), windowMax.z())
+    };
+    worldMin = worldMax = world.MultiplyPosition(corners[0]);
+    for (const vrb::Vector& corner: corners) {
+      const vrb::Vector point = world.MultiplyPosition(corner);
+      worldMin = vrb::Vector(std::min(worldMin.x(), point.x()), std::min(worldMin.y(), point.y()), std::min(worldMin.z(), point.z()));
+      worldMax = vrb::Vector(std::max(worldMax.x(), point.x()), std::max(worldMax.y(), point.y()), std::max(worldMax.z(), point.z()));
+    }
+    worldBoundsDirty = false;
   }
 };
 
@@ -208,15 +256,37 @@ Widget::GetWorldSize(float& aWidth, float& aHeight) const {
   aHeight = m.windowMax.y() - m.windowMin.y();
 }
 
+void
+Widget::GetWorldBounds(vrb::Vector& aMin, vrb::Vector& aMax) const {
+  m.UpdateWorldBounds();
+  aMin = m.worldMin;
+  aMax = m.worldMax;
+}
+
+const vrb::Vector&
+Widget::GetNormal() const {
+  return m.windowNormal;
+}
+
+const vrb::Matrix&
+Widget::GetWorldInverseTransform() const {
+  return m.GetWorldInverse();
+}
+
+bool
+Widget::IsVisible() const {
+  return m.visible;
+}
+
 static const float kEpsilon = 0.00000001f;
 
 bool
 Widget::TestControllerIntersection(const vrb::Vector& aStartPoint, const vrb::Vector& aDirection, vrb::Vector& aResult, bool& aIsInWidget, float& aDistance) const {
   aDistance = -1.0f;
-  if (!m.root->IsEnabled(*m.transform)) {
+  if (!IsVisible()) {
     return false;
   }
-  vrb::Matrix modelView = m.transform->GetWorldTransform().AfineInverse();
+  const vrb::Matrix& modelView = m.GetWorldInverse();
   vrb::Vector point = modelView.MultiplyPosition(aStartPoint);
   vrb::Vector direction = modelView.MultiplyDirection(aDirection);
   const float dotNormals = direction.Dot(m.windowNormal);
@@ -250,8 +320,6 @@ Widget::TestControllerIntersection(const vrb::Vector& aStartPoint, const vrb::Ve
   if (result.y() > m.windowMax.y()) { result.y() = m.windowMax.y(); }
   else if (result.y() < m.windowMin.y()) { result.y() = m.windowMin.y(); }
 
-  m.pointer->SetTransform(vrb::Matrix::Position(result));
-
   return true;
 }
 
@@ -281,19 +349,58 @@ Widget::GetTransform() const {
 void
 Widget::SetTransform(const vrb::Matrix& aTransform) {
   m.transform->SetTransform(aTransform);
+  m.worldInverseDirty = true;
+  m.worldBoundsDirty = true;
+  m.UpdatePointer();
 }
 
 void
 Widget::ToggleWidget(const bool aEnabled) {
-  m.root->ToggleAll(aEnabled);
+  m.visible = aEnabled;
+  m.root->ToggleAll(m.visible && m.inView);
+  m.UpdatePointerToggle();
 }
 
-void
+bool
+Widget::SetInView(const bool aInView) {
+  if (m.inView == aInView) {
+    return false;
+  }
+  m.inView = aInView;
+  if (!m.visible) {
+    return false;
+  }
+  m.root->ToggleAll(m.inView);
+  m.UpdatePointerToggle();
+  return true;
+}
+
+bool
 Widget::TogglePointer(const bool aEnabled) {
-  if (!m.pointerEnabled) {
-    return;
+  if (!m.pointerEnabled || (m.pointerVisible == aEnabled)) {
+    return false;
+  }
+  m.pointerVisible = aEnabled;
+  m.UpdatePointerToggle();
+  return true;
+}
+
+bool
+Widget::SetPointerLocation(const vrb::Vector& aPoint) {
+  vrb::Vector location = aPoint;
+  if (location.x() > m.windowMax.x()) { location.x() = m.windowMax.x(); }
+  else if (location.x() < m.windowMin.x()) { location.x() = m.windowMin.x(); }
+
+  if (location.y() > m.windowMax.y()) { location.y() = m.windowMax.y(); }
+  else if (location.y() < m.windowMin.y()) { location.y() = m.windowMin.y(); }
+
+  if ((location.x() == m.pointerLocation.x()) && (location.y() == m.pointerLocation.y()) &&
+      (location.z() == m.pointerLocation.z())) {
+    return false;
   }
-  m.pointerToggle->ToggleAll(aEnabled);
+  m.pointerLocation = location;
+  m.UpdatePointer();
+  return true;
 }
 
 vrb::NodePtr
@@ -301,6 +408,11 @@ Widget::GetRoot() const {
   return m.root;
 }
 
+vrb::NodePtr
+Widget::GetPointerRoot() const {
+  return m.pointerToggle;
+}
+
 vrb::TransformPtr
 Widget::GetTransformNode() const {
   return m.transform;
@@ -326,7 +438,8 @@ Widget::SetPointerGeometry(vrb::NodePtr& aNode) {
 void
 Widget::SetPointerEnabled(bool aEnabled) {
   m.pointerEnabled = aEnabled;
-  m.pointerToggle->ToggleAll(aEnabled);
+  m.pointerVisible = aEnabled;
+  m.UpdatePointerToggle();
 }
 
 void
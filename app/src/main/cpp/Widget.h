@@ -30,14 +30,29 @@ public:
   void GetSurfaceTextureSize(int32_t& aWidth, int32_t& aHeight) const;
   void GetWidgetMinAndMax(vrb::Vector& aMin, vrb::Vector& aMax) const;
   void GetWorldSize(float& aWidth, float& aHeight) const;
+  // Axis aligned, cached until the next SetTransform().
+  void GetWorldBounds(vrb::Vector& aMin, vrb::Vector& aMax) const;
+  const vrb::Vector& GetNormal() const;
+  const vrb::Matrix& GetWorldInverseTransform() const;
+  bool IsVisible() const;
   bool TestControllerIntersection(const vrb::Vector& aStartPoint, const vrb::Vector& aDirection, vrb::Vector& aResult, bool& aIsInWidget, float& aDistance) const;
   void ConvertToWidgetCoordinates(const vrb::Vector& aPoint, float& aX, float& aY) const;
   void ConvertToWorldCoordinates(const vrb::Vector& aPoint, vrb::Vector& aResult) const;
   const vrb::Matrix GetTransform() const;
   void SetTransform(const vrb::Matrix& aTransform);
   void ToggleWidget(const bool aEnabled);
-  void TogglePointer(const bool aEnabled);
+  // Hides a visible widget while it is outside the view frustum. IsVisible()
+  // is not affected. Returns true if the widget was shown or hidden.
+  bool SetInView(const bool aInView);
+  // Returns true if the pointer was shown or hidden by the call.
+  bool TogglePointer(const bool aEnabled);
+  // Moves the pointer to aPoint in widget space, clamped to the widget.
+  // Returns true if the pointer moved.
+  bool SetPointerLocation(const vrb::Vector& aPoint);
   vrb::NodePtr GetRoot() const;
+  // The pointer is positioned in world space and must be added to a group
+  // with an identity transform, separately from GetRoot().
+  vrb::NodePtr GetPointerRoot() const;
   vrb::TransformPtr GetTransformNode() const;
   vrb::NodePtr GetPointerGeometry() const;
   void SetPointerGeometry(vrb::NodePtr& aNode);
@@ -0,0 +1,337 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "WidgetBVH.h"
+#include "Widget.h"
+#include "WidgetHitTable.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/Vector.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace crow {
+
+namespace {
+
+// One SIMD iteration of WidgetHitTable::Intersect() per leaf.
+const int32_t kMaxLeafSize = 4;
+// Widget quads are flat, so their bounds are padded to keep a thickness.
+const float kBoundsPadding = 0.01f;
+
+struct Bounds {
+  float min[3];
+  float max[3];
+
+  void Reset() {
+    for (int32_t axis = 0; axis < 3; axis++) {
+      min[axis] = std::numeric_limits<float>::max();
+      max[axis] = -std::numeric_limits<float>::max();
+    }
+  }
+
+  void Extend(const Bounds& aBounds) {
+    for (int32_t axis = 0; axis < 3; axis++) {
+      min[axis] = std::min(min[axis], aBounds.min[axis]);
+      max[axis] = std::max(max[axis], aBounds.max[axis]);
+    }
+  }
+
+  float Center(const int32_t aAxis) const {
+    return (min[aAxis] + max[aAxis]) * 0.5f;
+  }
+
+  // Slab test. Returns the distance along the ray at which it enters the
+  // bounds, or a negative value when it misses them before aMaxDistance.
+  float Intersect(const float* aStart, const float* aInverseDirection, const float aMaxDistance) const {
+    float near = 0.0f;
+    float far = aMaxDistance;
+    for (int32_t axis = 0; axis < 3; axis++) {
+      float t0 = (min[axis] - aStart[axis]) * aInverseDirection[axis];
+      float t1 = (max[axis] - aStart[axis]) * aInverseDirection[axis];
+      if (t0 > t1) {
+        std::swap(t0, t1);
+      }
+      near = std::max(near, t0);
+      far = std::min(far, t1);
+      if (near > far) {
+        return -1.0f;
+      }
+    }
+    return near;
+  }
+};
+
+struct Leaf {
+  WidgetPtr widget;
+  Bounds bounds;
+  int32_t node; // Node that holds this leaf, used to refit after a move.
+  int32_t slot; // Entry in State::table.
+};
+
+struct Node {
+  Bounds bounds;
+  int32_t parent;
+  int32_t left; // Children, or -1 for a leaf node.
+  int32_t right;
+  int32_t first; // Range into State::order and State::table for leaf nodes.
+  int32_t count;
+};
+
+} // namespace
+
+struct WidgetBVH::State {
+  std::vector<Leaf> leaves;
+  // Indexed by widget handle, -1 when the widget is not in the tree. Build()
+  // only permutes order, so entries change only when leaves are added or
+  // removed.
+  std::vector<int32_t> leafByHandle;
+  std::vector<int32_t> order;
+  std::vector<Node> nodes;
+  std::vector<int32_t> dirtyLeaves;
+  WidgetHitTablePtr table;
+  bool rebuild;
+  State() : rebuild(false) {
+    table = WidgetHitTable::Create();
+  }
+
+  int32_t FindLeaf(const WidgetPtr& aWidget) const {
+    if (!aWidget) {
+      return -1;
+    }
+    const uint32_t handle = aWidget->GetHandle();
+    return handle < leafByHandle.size() ? leafByHandle[handle] : -1;
+  }
+
+  static void ComputeBounds(const WidgetPtr& aWidget, Bounds& aBounds) {
+    vrb::Vector min, max;
+    aWidget->GetWorldBounds(min, max);
+    for (int32_t axis = 0; axis < 3; axis++) {
+      aBounds.min[axis] = min.Data()[axis] - kBoundsPadding;
+      aBounds.max[axis] = max.Data()[axis] + kBoundsPadding;
+    }
+  }
+
+  int32_t Build(const int32_t aParent, const int32_t aFirst, const int32_t aCount) {
+    const int32_t index = (int32_t)nodes.size();
+    nodes.push_back(Node());
+    Node& node = nodes.back();
+    node.parent = aParent;
+    node.left = node.right = -1;
+    node.first = aFirst;
+    node.count = aCount;
+    node.bounds.Reset();
+    Bounds centers;
+    centers.Reset();
+    for (int32_t item = aFirst; item < aFirst + aCount; item++) {
+      const Bounds& bounds = leaves[order[item]].bounds;
+      node.bounds.Extend(bounds);
+      for (int32_t axis = 0; axis < 3; axis++) {
+        centers.min[axis] = std::min(centers.min[axis], bounds.Center(axis));
+        centers.max[axis] = std::max(centers.max[axis], bounds.Center(axis));
+      }
+    }
+    if (aCount <= kMaxLeafSize) {
+      for (int32_t item = aFirst; item < aFirst + aCount; item++) {
+        leaves[order[item]].node = index;
+      }
+      return index;
+    }
+    // Median split along the axis where the widget centers are spread the most.
+    int32_t axis = 0;
+    for (int32_t candidate = 1; candidate < 3; candidate++) {
+      if ((centers.max[candidate] - centers.min[candidate]) > (centers.max[axis] - centers.min[axis])) {
+        axis = candidate;
+      }
+    }
+    const int32_t half = aCount / 2;
+    std::nth_element(order.begin() + aFirst, order.begin() + aFirst + half, order.begin() + aFirst + aCount,
+                     [&](const int32_t aLeft, const int32_t aRight) {
+      return leaves[aLeft].bounds.Center(axis) < leaves[aRight].bounds.Center(axis);
+    });
+    // Build() grows nodes, so the children are stored through their index.
+    const int32_t left = Build(index, aFirst, half);
+    const int32_t right = Build(index, aFirst + half, aCount - half);
+    nodes[index].left = left;
+    nodes[index].right = right;
+    return index;
+  }
+
+  void Rebuild() {
+    nodes.clear();
+    order.resize(leaves.size());
+    for (size_t index = 0; index < leaves.size(); index++) {
+      order[index] = (int32_t)index;
+    }
+    if (!leaves.empty()) {
+      nodes.reserve(leaves.size() * 2);
+      Build(-1, 0, (int32_t)leaves.size());
+    }
+    // Lay the table out in leaf order so each leaf is a contiguous range.
+    table->SetCount((int32_t)order.size());
+    for (size_t slot = 0; slot < order.size(); slot++) {
+      Leaf& leaf = leaves[order[slot]];
+      leaf.slot = (int32_t)slot;
+      table->SetWidget(leaf.slot, *leaf.widget);
+    }
+    dirtyLeaves.clear();
+    rebuild = false;
+  }
+
+  void Refit() {
+    for (const int32_t leafIndex: dirtyLeaves) {
+      table->SetWidget(leaves[leafIndex].slot, *leaves[leafIndex].widget);
+      int32_t nodeIndex = leaves[leafIndex].node;
+      while (nodeIndex >= 0) {
+        Node& node = nodes[nodeIndex];
+        node.bounds.Reset();
+        if (node.left < 0) {
+          for (int32_t item = node.first; item < node.first + node.count; item++) {
+            node.bounds.Extend(leaves[order[item]].bounds);
+          }
+        } else {
+          node.bounds.Extend(nodes[node.left].bounds);
+          node.bounds.Extend(nodes[node.right].bounds);
+        }
+        nodeIndex = node.parent;
+      }
+    }
+    dirtyLeaves.clear();
+  }
+
+  void Prepare() {
+    if (rebuild) {
+      Rebuild();
+    } else if (!dirtyLeaves.empty()) {
+      Refit();
+    }
+  }
+};
+
+WidgetBVHPtr
+WidgetBVH::Create() {
+  return std::make_shared<vrb::ConcreteClass<WidgetBVH, WidgetBVH::State> >();
+}
+
+void
+WidgetBVH::AddWidget(const WidgetPtr& aWidget) {
+  if (!aWidget || (m.FindLeaf(aWidget) >= 0)) {
+    return;
+  }
+  Leaf leaf;
+  leaf.widget = aWidget;
+  leaf.node = -1;
+  leaf.slot = -1;
+  State::ComputeBounds(aWidget, leaf.bounds);
+  const uint32_t handle = aWidget->GetHandle();
+  if (handle >= m.leafByHandle.size()) {
+    m.leafByHandle.resize(handle + 1, -1);
+  }
+  m.leafByHandle[handle] = (int32_t)m.leaves.size();
+  m.leaves.push_back(leaf);
+  m.rebuild = true;
+}
+
+void
+WidgetBVH::RemoveWidget(const WidgetPtr& aWidget) {
+  const int32_t index = m.FindLeaf(aWidget);
+  if (index < 0) {
+    return;
+  }
+  // The tree is rebuilt anyway, so the last leaf fills the gap.
+  m.leafByHandle[aWidget->GetHandle()] = -1;
+  if (index != (int32_t)m.leaves.size() - 1) {
+    m.leaves[index] = m.leaves.back();
+    m.leafByHandle[m.leaves[index].widget->GetHandle()] = index;
+  }
+  m.leaves.pop_back();
+  m.rebuild = true;
+}
+
+void
+WidgetBVH::UpdateWidget(const WidgetPtr& aWidget) {
+  const int32_t index = m.FindLeaf(aWidget);
+  if (index < 0) {
+    return;
+  }
+  State::ComputeBounds(aWidget, m.leaves[index].bounds);
+  if (!m.rebuild) {
+    m.dirtyLeaves.push_back(index);
+  }
+}
+
+int32_t
+WidgetBVH::GetWidgetCount() const {
+  return (int32_t)m.leaves.size();
+}
+
+WidgetPtr
+WidgetBVH::RayQuery(const vrb::Vector& aStart, const vrb::Vector& aDirection, const float aMaxDistance,
+                    vrb::Vector& aHitPoint, float& aHitDistance) const {
+  m.Prepare();
+  WidgetPtr result;
+  aHitDistance = aMaxDistance;
+  if (m.nodes.empty()) {
+    return result;
+  }
+  const float start[3] = {aStart.x(), aStart.y(), aStart.z()};
+  float inverseDirection[3];
+  for (int32_t axis = 0; axis < 3; axis++) {
+    const float value = aDirection.Data()[axis];
+    inverseDirection[axis] = value != 0.0f ? 1.0f / value : std::numeric_limits<float>::infinity();
+  }
+
+  // Depth first traversal that visits the nearer child first and skips any
+  // subtree that starts beyond the closest hit found so far.
+  int32_t stack[64];
+  int32_t depth = 0;
+  stack[depth++] = 0;
+  while (depth > 0) {
+    const Node& node = m.nodes[stack[--depth]];
+    if (node.bounds.Intersect(start, inverseDirection, aHitDistance) < 0.0f) {
+      continue;
+    }
+    if (node.left < 0) {
+      WidgetHitTable::Hit hits[kMaxLeafSize];
+      m.table->Intersect(aStart, aDirection, node.first, node.count, hits);
+      for (int32_t item = 0; item < node.count; item++) {
+        const WidgetHitTable::Hit& hit = hits[item];
+        if (!hit.inWidget || (hit.distance >= aHitDistance)) {
+          continue;
+        }
+        const WidgetPtr& widget = m.leaves[m.order[node.first + item]].widget;
+        if (widget->IsVisible()) {
+          result = widget;
+          aHitDistance = hit.distance;
+          aHitPoint = hit.point;
+        }
+      }
+      continue;
+    }
+    const float leftDistance = m.nodes[node.left].bounds.Intersect(start, inverseDirection, aHitDistance);
+    const float rightDistance = m.nodes[node.right].bounds.Intersect(start, inverseDirection, aHitDistance);
+    // Push the farther child first so the nearer one is popped next.
+    if ((leftDistance >= 0.0f) && (rightDistance >= 0.0f)) {
+      if (leftDistance < rightDistance) {
+        stack[depth++] = node.right;
+        stack[depth++] = node.left;
+      } else {
+        stack[depth++] = node.left;
+        stack[depth++] = node.right;
+      }
+    } else if (leftDistance >= 0.0f) {
+      stack[depth++] = node.left;
+    } else if (rightDistance >= 0.0f) {
+      stack[depth++] = node.right;
+    }
+  }
+  return result;
+}
+
+WidgetBVH::WidgetBVH(State& aState) : m(aState) {}
+WidgetBVH::~WidgetBVH() {}
+
+} // namespace crow
@@ -0,0 +1,50 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_WIDGET_BVH_DOT_H
+#define VRBROWSER_WIDGET_BVH_DOT_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+
+#include <memory>
+
+namespace crow {
+
+class Widget;
+typedef std::shared_ptr<Widget> WidgetPtr;
+class WidgetBVH;
+typedef std::shared_ptr<WidgetBVH> WidgetBVHPtr;
+
+// Bounding volume hierarchy over the world space bounds of widget quads, used
+// to find which widget a controller ray points at without testing every
+// widget. Adding or removing a widget rebuilds the tree on the next query;
+// moving one only refits the bounds along its path. Each leaf holds up to four
+// widgets, which are tested together by WidgetHitTable.
+class WidgetBVH {
+public:
+  static WidgetBVHPtr Create();
+  void AddWidget(const WidgetPtr& aWidget);
+  void RemoveWidget(const WidgetPtr& aWidget);
+  // Must be called after a widget has been transformed.
+  void UpdateWidget(const WidgetPtr& aWidget);
+  int32_t GetWidgetCount() const;
+  // Returns the nearest visible widget whose quad the ray hits within
+  // aMaxDistance, along with the hit point in widget space and its distance.
+  WidgetPtr RayQuery(const vrb::Vector& aStart, const vrb::Vector& aDirection, const float aMaxDistance,
+                     vrb::Vector& aHitPoint, float& aHitDistance) const;
+protected:
+  struct State;
+  WidgetBVH(State& aState);
+  ~WidgetBVH();
+private:
+  State& m;
+  WidgetBVH() = delete;
+  VRB_NO_DEFAULTS(WidgetBVH)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_WIDGET_BVH_DOT_H
@@ -0,0 +1,325 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "WidgetHitTable.h"
+#include "Widget.h"
+#include "vrb/ConcreteClass.h"
+#include "vrb/Matrix.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+// The scalar and SIMD paths must round identically, so a multiply followed by
+// an add must not be fused into one instruction. GCC ignores this pragma, so
+// both CMakeLists.txt also build this file with -ffp-contract=off.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#endif
+
+namespace crow {
+
+namespace {
+
+const float kEpsilon = 0.00000001f;
+const float kDepthSlack = 0.1f;
+
+enum Field {
+  // Inverse world transform, split into its translation and the images of the
+  // x, y and z axes.
+  TranslationX, TranslationY, TranslationZ,
+  AxisXX, AxisXY, AxisXZ,
+  AxisYX, AxisYY, AxisYZ,
+  AxisZX, AxisZY, AxisZZ,
+  NormalX, NormalY, NormalZ,
+  MinX, MinY, MinZ,
+  MaxX, MaxY, MaxZ,
+  FieldCount
+};
+
+struct ScalarLanes {
+  typedef float Value;
+  typedef bool Mask;
+  static const int32_t kWidth = 1;
+  static Value Load(const float* aData) { return *aData; }
+  static Value Splat(const float aValue) { return aValue; }
+  static void Store(float* aData, const Value aValue) { *aData = aValue; }
+  static Value Add(const Value aLeft, const Value aRight) { return aLeft + aRight; }
+  static Value Sub(const Value aLeft, const Value aRight) { return aLeft - aRight; }
+  static Value Mul(const Value aLeft, const Value aRight) { return aLeft * aRight; }
+  static Value Div(const Value aLeft, const Value aRight) { return aLeft / aRight; }
+  static Value Sqrt(const Value aValue) { return std::sqrt(aValue); }
+  static Mask Greater(const Value aLeft, const Value aRight) { return aLeft > aRight; }
+  static Mask GreaterEqual(const Value aLeft, const Value aRight) { return aLeft >= aRight; }
+  static Mask And(const Mask aLeft, const Mask aRight) { return aLeft && aRight; }
+  static Mask Or(const Mask aLeft, const Mask aRight) { return aLeft || aRight; }
+  static int32_t Bits(const Mask aMask) { return aMask ? 1 : 0; }
+};
+
+#if defined(__SSE2__)
+
+struct SimdLanes {
+  typedef __m128 Value;
+  typedef __m128 Mask;
+  static const int32_t kWidth = 4;
+  static Value Load(const float* aData) { return _mm_loadu_ps(aData); }
+  static Value Splat(const float aValue) { return _mm_set1_ps(aValue); }
+  static void Store(float* aData, const Value aValue) { _mm_storeu_ps(aData, aValue); }
+  static Value Add(const Value aLeft, const Value aRight) { return _mm_add_ps(aLeft, aRight); }
+  static Value Sub(const Value aLeft, const Value aRight) { return _mm_sub_ps(aLeft, aRight); }
+  static Value Mul(const Value aLeft, const Value aRight) { return _mm_mul_ps(aLeft, aRight); }
+  static Value Div(const Value aLeft, const Value aRight) { return _mm_div_ps(aLeft, aRight); }
+  static Value Sqrt(const Value aValue) { return _mm_sqrt_ps(aValue); }
+  static Mask Greater(const Value aLeft, const Value aRight) { return _mm_cmpgt_ps(aLeft, aRight); }
+  static Mask GreaterEqual(const Value aLeft, const Value aRight) { return _mm_cmpge_ps(aLeft, aRight); }
+  static Mask And(const Mask aLeft, const Mask aRight) { return _mm_and_ps(aLeft, aRight); }
+  static Mask Or(const Mask aLeft, const Mask aRight) { return _mm_or_ps(aLeft, aRight); }
+  static int32_t Bits(const Mask aMask) { return _mm_movemask_ps(aMask); }
+};
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+struct SimdLanes {
+  typedef float32x4_t Value;
+  typedef uint32x4_t Mask;
+  static const int32_t kWidth = 4;
+  static Value Load(const float* aData) { return vld1q_f32(aData); }
+  static Value Splat(const float aValue) { return vdupq_n_f32(aValue); }
+  static void Store(float* aData, const Value aValue) { vst1q_f32(aData, aValue); }
+  static Value Add(const Value aLeft, const Value aRight) { return vaddq_f32(aLeft, aRight); }
+  static Value Sub(const Value aLeft, const Value aRight) { return vsubq_f32(aLeft, aRight); }
+  static Value Mul(const Value aLeft, const Value aRight) { return vmulq_f32(aLeft, aRight); }
+#if defined(__aarch64__)
+  static Value Div(const Value aLeft, const Value aRight) { return vdivq_f32(aLeft, aRight); }
+  static Value Sqrt(const Value aValue) { return vsqrtq_f32(aValue); }
+#else
+  // ARMv7 NEON only has reciprocal estimates, which would not match the scalar
+  // path, so division and square root are done per lane.
+  static Value Div(const Value aLeft, const Value aRight) {
+    float left[kWidth], right[kWidth];
+    vst1q_f32(left, aLeft);
+    vst1q_f32(right, aRight);
+    for (int32_t lane = 0; lane < kWidth; lane++) {
+      left[lane] = left[lane] / right[lane];
+    }
+    return vld1q_f32(left);
+  }
+  static Value Sqrt(const Value aValue) {
+    float values[kWidth];
+    vst1q_f32(values, aValue);
+    for (int32_t lane = 0; lane < kWidth; lane++) {
+      values[lane] = std::sqrt(values[lane]);
+    }
+    return vld1q_f32(values);
+  }
+#endif
+  static Mask Greater(const Value aLeft, const Value aRight) { return vcgtq_f32(aLeft, aRight); }
+  static Mask GreaterEqual(const Value aLeft, const Value aRight) { return vcgeq_f32(aLeft, aRight); }
+  static Mask And(const Mask aLeft, const Mask aRight) { return vandq_u32(aLeft, aRight); }
+  static Mask Or(const Mask aLeft, const Mask aRight) { return vorrq_u32(aLeft, aRight); }
+  static int32_t Bits(const Mask aMask) {
+    uint32_t lanes[kWidth];
+    vst1q_u32(lanes, aMask);
+    return (lanes[0] & 1) | (lanes[1] & 2) | (lanes[2] & 4) | (lanes[3] & 8);
+  }
+};
+
+#else
+
+typedef ScalarLanes SimdLanes;
+
+#endif
+
+} // namespace
+
+const int32_t WidgetHitTable::kLaneCount = SimdLanes::kWidth;
+
+struct WidgetHitTable::State {
+  int32_t count;
+  int32_t capacity;
+  // Field major: the value of field F for widget I is at data[F * capacity + I].
+  std::vector<float> data;
+  State() : count(0), capacity(0) {}
+
+  const float* Get(const Field aField, const int32_t aIndex) const {
+    return &data[aField * capacity + aIndex];
+  }
+
+  void Set(const Field aField, const int32_t aIndex, const float aValue) {
+    data[aField * capacity + aIndex] = aValue;
+  }
+
+  void Set(const Field aField, const int32_t aIndex, const vrb::Vector& aValue) {
+    Set(aField, aIndex, aValue.x());
+    Set((Field)(aField + 1), aIndex, aValue.y());
+    Set((Field)(aField + 2), aIndex, aValue.z());
+  }
+
+  // Mirrors Widget::TestControllerIntersection. Both the scalar and the SIMD
+  // path run this same sequence of operations so they round identically.
+  template <typename T>
+  void Intersect(const vrb::Vector& aStart, const vrb::Vector& aDirection,
+                 const int32_t aFirst, const int32_t aCount, Hit* aResults) const {
+    typedef typename T::Value Value;
+    typedef typename T::Mask Mask;
+    const Value startX = T::Splat(aStart.x());
+    const Value startY = T::Splat(aStart.y());
+    const Value startZ = T::Splat(aStart.z());
+    const Value directionX = T::Splat(aDirection.x());
+    const Value directionY = T::Splat(aDirection.y());
+    const Value directionZ = T::Splat(aDirection.z());
+    const Value epsilon = T::Splat(kEpsilon);
+    const Value negativeEpsilon = T::Splat(-kEpsilon);
+    const Value slack = T::Splat(kDepthSlack);
+    for (int32_t base = 0; base < aCount; base += T::kWidth) {
+      const int32_t index = aFirst + base;
+      const Value axisXX = T::Load(Get(AxisXX, index));
+      const Value axisXY = T::Load(Get(AxisXY, index));
+      const Value axisXZ = T::Load(Get(AxisXZ, index));
+      const Value axisYX = T::Load(Get(AxisYX, index));
+      const Value axisYY = T::Load(Get(AxisYY, index));
+      const Value axisYZ = T::Load(Get(AxisYZ, index));
+      const Value axisZX = T::Load(Get(AxisZX, index));
+      const Value axisZY = T::Load(Get(AxisZY, index));
+      const Value axisZZ = T::Load(Get(AxisZZ, index));
+      const Value pointX = T::Add(T::Add(T::Add(T::Load(Get(TranslationX, index)), T::Mul(axisXX, startX)),
+                                         T::Mul(axisYX, startY)), T::Mul(axisZX, startZ));
+      const Value pointY = T::Add(T::Add(T::Add(T::Load(Get(TranslationY, index)), T::Mul(axisXY, startX)),
+                                         T::Mul(axisYY, startY)), T::Mul(axisZY, startZ));
+      const Value pointZ = T::Add(T::Add(T::Add(T::Load(Get(TranslationZ, index)), T::Mul(axisXZ, startX)),
+                                         T::Mul(axisYZ, startY)), T::Mul(axisZZ, startZ));
+      const Value rayX = T::Add(T::Add(T::Mul(axisXX, directionX), T::Mul(axisYX, directionY)),
+                                T::Mul(axisZX, directionZ));
+      const Value rayY = T::Add(T::Add(T::Mul(axisXY, directionX), T::Mul(axisYY, directionY)),
+                                T::Mul(axisZY, directionZ));
+      const Value rayZ = T::Add(T::Add(T::Mul(axisXZ, directionX), T::Mul(axisYZ, directionY)),
+                                T::Mul(axisZZ, directionZ));
+
+      const Value normalX = T::Load(Get(NormalX, index));
+      const Value normalY = T::Load(Get(NormalY, index));
+      const Value normalZ = T::Load(Get(NormalZ, index));
+      const Value minX = T::Load(Get(MinX, index));
+      const Value minY = T::Load(Get(MinY, index));
+      const Value minZ = T::Load(Get(MinZ, index));
+      const Value maxX = T::Load(Get(MaxX, index));
+      const Value maxY = T::Load(Get(MaxY, index));
+      const Value maxZ = T::Load(Get(MaxZ, index));
+
+      const Value dotNormals = T::Add(T::Add(T::Mul(rayX, normalX), T::Mul(rayY, normalY)), T::Mul(rayZ, normalZ));
+      const Value dotV = T::Add(T::Add(T::Mul(T::Sub(minX, pointX), normalX), T::Mul(T::Sub(minY, pointY), normalY)),
+                                T::Mul(T::Sub(minZ, pointZ), normalZ));
+      // Not pointed at the plane, or starting on it.
+      const Mask miss = T::Or(T::Greater(dotNormals, negativeEpsilon),
+                              T::And(T::Greater(epsilon, dotV), T::Greater(dotV, negativeEpsilon)));
+
+      const Value length = T::Div(dotV, dotNormals);
+      const Value resultX = T::Add(pointX, T::Mul(rayX, length));
+      const Value resultY = T::Add(pointY, T::Mul(rayY, length));
+      const Value resultZ = T::Add(pointZ, T::Mul(rayZ, length));
+      const Mask inWidget = T::And(T::And(T::And(T::GreaterEqual(resultX, minX), T::GreaterEqual(resultY, minY)),
+                                          T::And(T::GreaterEqual(resultZ, T::Sub(minZ, slack)),
+                                                 T::GreaterEqual(maxX, resultX))),
+                                   T::And(T::GreaterEqual(maxY, resultY),
+                                          T::GreaterEqual(T::Add(maxZ, slack), resultZ)));
+      const Value offsetX = T::Sub(resultX, pointX);
+      const Value offsetY = T::Sub(resultY, pointY);
+      const Value offsetZ = T::Sub(resultZ, pointZ);
+      const Value distance = T::Sqrt(T::Add(T::Add(T::Mul(offsetX, offsetX), T::Mul(offsetY, offsetY)),
+                                            T::Mul(offsetZ, offsetZ)));
+
+      float x[T::kWidth], y[T::kWidth], z[T::kWidth], distances[T::kWidth];
+      T::Store(x, resultX);
+      T::Store(y, resultY);
+      T::Store(z, resultZ);
+      T::Store(distances, distance);
+      const int32_t missBits = T::Bits(miss);
+      const int32_t inWidgetBits = T::Bits(inWidget);
+      const int32_t remaining = aCount - base;
+      const int32_t lanes = remaining < T::kWidth ? remaining : T::kWidth;
+      for (int32_t lane = 0; lane < lanes; lane++) {
+        Hit& result = aResults[base + lane];
+        result.hit = ((missBits >> lane) & 1) == 0;
+        result.inWidget = result.hit && (((inWidgetBits >> lane) & 1) != 0);
+        result.distance = result.hit ? distances[lane] : -1.0f;
+        if (result.hit) {
+          result.point = vrb::Vector(x[lane], y[lane], z[lane]);
+        }
+      }
+    }
+  }
+};
+
+WidgetHitTablePtr
+WidgetHitTable::Create() {
+  return std::make_shared<vrb::ConcreteClass<WidgetHitTable, WidgetHitTable::State> >();
+}
+
+int32_t
+WidgetHitTable::GetCount() const {
+  return m.count;
+}
+
+void
+WidgetHitTable::SetCount(const int32_t aCount) {
+  // Intersect() reads whole SIMD iterations from any first index, so keep
+  // kLaneCount - 1 entries of padding past the end. The padding has a zero
+  // normal, which never counts as pointed at.
+  const int32_t capacity = ((aCount + (2 * kLaneCount) - 2) / kLaneCount) * kLaneCount;
+  if (capacity != m.capacity) {
+    std::vector<float> data(FieldCount * capacity, 0.0f);
+    const int32_t kept = std::min(m.count, aCount);
+    for (int32_t field = 0; field < FieldCount; field++) {
+      std::copy(m.data.begin() + field * m.capacity, m.data.begin() + field * m.capacity + kept,
+                data.begin() + field * capacity);
+    }
+    m.data.swap(data);
+    m.capacity = capacity;
+  } else if (aCount < m.count) {
+    for (int32_t field = 0; field < FieldCount; field++) {
+      std::fill(m.data.begin() + field * m.capacity + aCount, m.data.begin() + field * m.capacity + m.count, 0.0f);
+    }
+  }
+  m.count = aCount;
+}
+
+void
+WidgetHitTable::SetWidget(const int32_t aIndex, const Widget& aWidget) {
+  if ((aIndex < 0) || (aIndex >= m.count)) {
+    return;
+  }
+  const vrb::Matrix& inverse = aWidget.GetWorldInverseTransform();
+  m.Set(TranslationX, aIndex, inverse.MultiplyPosition(vrb::Vector(0.0f, 0.0f, 0.0f)));
+  m.Set(AxisXX, aIndex, inverse.MultiplyDirection(vrb::Vector(1.0f, 0.0f, 0.0f)));
+  m.Set(AxisYX, aIndex, inverse.MultiplyDirection(vrb::Vector(0.0f, 1.0f, 0.0f)));
+  m.Set(AxisZX, aIndex, inverse.MultiplyDirection(vrb::Vector(0.0f, 0.0f, 1.0f)));
+  m.Set(NormalX, aIndex, aWidget.GetNormal());
+  vrb::Vector min, max;
+  aWidget.GetWidgetMinAndMax(min, max);
+  m.Set(MinX, aIndex, min);
+  m.Set(MaxX, aIndex, max);
+}
+
+void
+WidgetHitTable::Intersect(const vrb::Vector& aStart, const vrb::Vector& aDirection,
+                          const int32_t aFirst, const int32_t aCount, Hit* aResults) const {
+  m.Intersect<SimdLanes>(aStart, aDirection, aFirst, aCount, aResults);
+}
+
+void
+WidgetHitTable::IntersectScalar(const vrb::Vector& aStart, const vrb::Vector& aDirection,
+                                const int32_t aFirst, const int32_t aCount, Hit* aResults) const {
+  m.Intersect<ScalarLanes>(aStart, aDirection, aFirst, aCount, aResults);
+}
+
+WidgetHitTable::WidgetHitTable(State& aState) : m(aState) {}
+WidgetHitTable::~WidgetHitTable() {}
+
+} // namespace crow
@@ -0,0 +1,60 @@
+/* -*- Mode: C++; tab-width: 20; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef VRBROWSER_WIDGET_HIT_TABLE_DOT_H
+#define VRBROWSER_WIDGET_HIT_TABLE_DOT_H
+
+#include "vrb/Forward.h"
+#include "vrb/MacroUtils.h"
+#include "vrb/Vector.h"
+
+#include <memory>
+
+namespace crow {
+
+class Widget;
+class WidgetHitTable;
+typedef std::shared_ptr<WidgetHitTable> WidgetHitTablePtr;
+
+// Structure of arrays copy of the widget quads (inverse world transform, plane
+// and bounds) so a controller ray can be tested against several widgets per
+// iteration with SSE or NEON. Follows the hit and bounds rules of
+// Widget::TestControllerIntersection, but does not check widget visibility.
+class WidgetHitTable {
+public:
+  struct Hit {
+    vrb::Vector point; // Widget space, only set when hit is true.
+    float distance;    // -1 when hit is false.
+    bool hit;          // The ray points at the widget plane.
+    bool inWidget;     // The ray hits within the widget bounds.
+  };
+  // Number of widgets tested per iteration by Intersect().
+  static const int32_t kLaneCount;
+
+  static WidgetHitTablePtr Create();
+  int32_t GetCount() const;
+  void SetCount(const int32_t aCount);
+  void SetWidget(const int32_t aIndex, const Widget& aWidget);
+  // Tests the ray against the widgets in [aFirst, aFirst + aCount). aResults
+  // must hold aCount entries.
+  void Intersect(const vrb::Vector& aStart, const vrb::Vector& aDirection,
+                 const int32_t aFirst, const int32_t aCount, Hit* aResults) const;
+  // Same as Intersect() one widget at a time without SIMD. The results are
+  // bit identical.
+  void IntersectScalar(const vrb::Vector& aStart, const vrb::Vector& aDirection,
+                       const int32_t aFirst, const int32_t aCount, Hit* aResults) const;
+protected:
+  struct State;
+  WidgetHitTable(State& aState);
+  ~WidgetHitTable();
+private:
+  State& m;
+  WidgetHitTable() = delete;
+  VRB_NO_DEFAULTS(WidgetHitTable)
+};
+
+} // namespace crow
+
+#endif // VRBROWSER_WIDGET_HIT_TABLE_DOT_H
@@ -4,47 +4,210 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include "WidgetPlacement.h"
+#include "vrb/Logger.h"
+#include "vrb/Matrix.h"
 
 namespace crow {
 
 WidgetPlacementPtr
-WidgetPlacement::FromJava(JNIEnv* aEnv, jobject& aObject) {
-  if (!aObject) {
-    return nullptr;
+WidgetPlacement::Create() {
+  WidgetPlacementPtr result(new WidgetPlacement());
+  result->widgetType = 0;
+  result->width = 0;
+  result->height = 0;
+  result->anchor = vrb::Vector(0.5f, 0.5f, 0.0f);
+  result->rotation = 0.0f;
+  result->parentHandle = -1;
+  result->parentAnchor = vrb::Vector(0.5f, 0.5f, 0.0f);
+  result->worldScale = 1.0f;
+  return result;
+}
+
+namespace {
+
+const char* kWidgetPlacementClassName = "org.mozilla.vrbrowser.WidgetPlacement";
+
+struct JavaFields {
+  bool resolved = false;
+  jfieldID widgetType = nullptr;
+  jfieldID width = nullptr;
+  jfieldID height = nullptr;
+  jfieldID anchorX = nullptr;
+  jfieldID anchorY = nullptr;
+  jfieldID translationX = nullptr;
+  jfieldID translationY = nullptr;
+  jfieldID translationZ = nullptr;
+  jfieldID rotationAxisX = nullptr;
+  jfieldID rotationAxisY = nullptr;
+  jfieldID rotationAxisZ = nullptr;
+  jfieldID rotation = nullptr;
+  jfieldID parentHandle = nullptr;
+  jfieldID parentAnchorX = nullptr;
+  jfieldID parentAnchorY = nullptr;
+  jfieldID worldScale = nullptr;
+};
+
+// Field IDs stay valid as long as the class is loaded, which is the lifetime
+// of the activity, so they are only dropped in ShutdownJava().
+JavaFields sFields;
+
+bool
+ResolveFields(JNIEnv* aEnv, jclass aClass) {
+#define RESOLVE_FIELD(name, signature) \
+  sFields.name = aEnv->GetFieldID(aClass, #name, signature); \
+  if (!sFields.name) { \
+    VRB_LOG("Failed to find Java field: WidgetPlacement.%s", #name); \
+    aEnv->ExceptionClear(); \
+    return false; \
   }
 
-  jclass clazz = aEnv->GetObjectClass(aObject);
+  RESOLVE_FIELD(widgetType, "I");
+  RESOLVE_FIELD(width, "I");
+  RESOLVE_FIELD(height, "I");
+  RESOLVE_FIELD(anchorX, "F");
+  RESOLVE_FIELD(anchorY, "F");
+  RESOLVE_FIELD(translationX, "F");
+  RESOLVE_FIELD(translationY, "F");
+  RESOLVE_FIELD(translationZ, "F");
+  RESOLVE_FIELD(rotationAxisX, "F");
+  RESOLVE_FIELD(rotationAxisY, "F");
+  RESOLVE_FIELD(rotationAxisZ, "F");
+  RESOLVE_FIELD(rotation, "F");
+  RESOLVE_FIELD(parentHandle, "I");
+  RESOLVE_FIELD(parentAnchorX, "F");
+  RESOLVE_FIELD(parentAnchorY, "F");
+  RESOLVE_FIELD(worldScale, "F");
 
-  std::shared_ptr<WidgetPlacement> result(new WidgetPlacement());;
+#undef RESOLVE_FIELD
 
-#define GET_INT_FIELD(name) { \
-  jfieldID f = aEnv->GetFieldID(clazz, #name, "I"); \
-  result->name = aEnv->GetIntField(aObject, f); \
+  sFields.resolved = true;
+  return true;
 }
 
-#define GET_FLOAT_FIELD(to, name) { \
-  jfieldID f = aEnv->GetFieldID(clazz, name, "F"); \
-  result->to = aEnv->GetFloatField(aObject, f); \
+jclass
+LoadClass(JNIEnv* aEnv, jobject aActivity, const char* aName) {
+  jclass activityClass = aEnv->GetObjectClass(aActivity);
+  jmethodID getClassLoader = aEnv->GetMethodID(activityClass, "getClassLoader", "()Ljava/lang/ClassLoader;");
+  jobject loader = getClassLoader ? aEnv->CallObjectMethod(aActivity, getClassLoader) : nullptr;
+  jclass result = nullptr;
+  if (loader) {
+    jclass loaderClass = aEnv->GetObjectClass(loader);
+    jmethodID loadClass = aEnv->GetMethodID(loaderClass, "loadClass", "(Ljava/lang/String;)Ljava/lang/Class;");
+    jstring name = aEnv->NewStringUTF(aName);
+    if (loadClass && name) {
+      result = (jclass) aEnv->CallObjectMethod(loader, loadClass, name);
+    }
+    aEnv->DeleteLocalRef(name);
+    aEnv->DeleteLocalRef(loaderClass);
+    aEnv->DeleteLocalRef(loader);
+  }
+  aEnv->DeleteLocalRef(activityClass);
+  if (aEnv->ExceptionCheck()) {
+    aEnv->ExceptionClear();
+    result = nullptr;
+  }
+  return result;
+}
+
+} // namespace
+
+void
+WidgetPlacement::InitializeJava(JNIEnv* aEnv, jobject aActivity) {
+  if (sFields.resolved || !aEnv || !aActivity) {
+    return;
+  }
+  jclass clazz = LoadClass(aEnv, aActivity, kWidgetPlacementClassName);
+  if (!clazz) {
+    VRB_LOG("Failed to load Java class: %s", kWidgetPlacementClassName);
+    return;
+  }
+  ResolveFields(aEnv, clazz);
+  aEnv->DeleteLocalRef(clazz);
 }
 
-  GET_INT_FIELD(widgetType);
-  GET_INT_FIELD(width);
-  GET_INT_FIELD(height);
-  GET_FLOAT_FIELD(anchor.x(), "anchorX");
-  GET_FLOAT_FIELD(anchor.y(), "anchorY");
-  GET_FLOAT_FIELD(translation.x(), "translationX");
-  GET_FLOAT_FIELD(translation.y(), "translationY");
-  GET_FLOAT_FIELD(translation.z(), "translationZ");
-  GET_FLOAT_FIELD(rotationAxis.x(), "rotationAxisX");
-  GET_FLOAT_FIELD(rotationAxis.y(), "rotationAxisY");
-  GET_FLOAT_FIELD(rotationAxis.z(), "rotationAxisZ");
-  GET_FLOAT_FIELD(rotation, "rotation");
-  GET_INT_FIELD(parentHandle);
-  GET_FLOAT_FIELD(parentAnchor.x(), "parentAnchorX");
-  GET_FLOAT_FIELD(parentAnchor.y(), "parentAnchorY");
-  GET_FLOAT_FIELD(worldScale, "worldScale");
+void
+WidgetPlacement::ShutdownJava() {
+  sFields = JavaFields();
+}
 
+bool
+WidgetPlacement::FromJava(JNIEnv* aEnv, jobject aObject, WidgetPlacement& aResult) {
+  if (!aObject) {
+    return false;
+  }
+
+  if (!sFields.resolved) {
+    // InitializeJava() could not load the class, fall back to the class of
+    // the object we were handed.
+    jclass clazz = aEnv->GetObjectClass(aObject);
+    const bool resolved = ResolveFields(aEnv, clazz);
+    aEnv->DeleteLocalRef(clazz);
+    if (!resolved) {
+      return false;
+    }
+  }
+
+#define GET_INT_FIELD(to, name) \
+  aResult.to = aEnv->GetIntField(aObject, sFields.name);
+
+#define GET_FLOAT_FIELD(to, name) \
+  aResult.to = aEnv->GetFloatField(aObject, sFields.name);
+
+  GET_INT_FIELD(widgetType, widgetType);
+  GET_INT_FIELD(width, width);
+  GET_INT_FIELD(height, height);
+  GET_FLOAT_FIELD(anchor.x(), anchorX);
+  GET_FLOAT_FIELD(anchor.y(), anchorY);
+  GET_FLOAT_FIELD(translation.x(), translationX);
+  GET_FLOAT_FIELD(translation.y(), translationY);
+  GET_FLOAT_FIELD(translation.z(), translationZ);
+  GET_FLOAT_FIELD(rotationAxis.x(), rotationAxisX);
+  GET_FLOAT_FIELD(rotationAxis.y(), rotationAxisY);
+  GET_FLOAT_FIELD(rotationAxis.z(), rotationAxisZ);
+  GET_FLOAT_FIELD(rotation, rotation);
+  GET_INT_FIELD(parentHandle, parentHandle);
+  GET_FLOAT_FIELD(parentAnchor.x(), parentAnchorX);
+  GET_FLOAT_FIELD(parentAnchor.y(), parentAnchorY);
+  GET_FLOAT_FIELD(worldScale, worldScale);
+
+#undef GET_INT_FIELD
+#undef GET_FLOAT_FIELD
+
+  return true;
+}
+
+WidgetPlacementPtr
+WidgetPlacement::FromJava(JNIEnv* aEnv, jobject& aObject) {
+  WidgetPlacementPtr result = Create();
+  if (!FromJava(aEnv, aObject, *result)) {
+    return nullptr;
+  }
   return result;
 }
 
+vrb::Matrix
+WidgetPlacement::GetTransform(const vrb::Matrix& aParentTransform,
+                              const float aParentWorldWidth, const float aParentWorldHeight,
+                              const float aWorldWidth, const float aWorldHeight) const {
+  vrb::Matrix transform = vrb::Matrix::Identity();
+  if (rotation != 0.0) {
+    transform = vrb::Matrix::Rotation(rotationAxis, rotation);
+  }
+
+  vrb::Vector position = vrb::Vector(translation.x() * kWorldDPIRatio,
+                                     translation.y() * kWorldDPIRatio,
+                                     translation.z() * kWorldDPIRatio);
+  // Widget anchor point
+  position -= vrb::Vector((anchor.x() - 0.5f) * aWorldWidth,
+                          anchor.y() * aWorldHeight,
+                          0.0f);
+  // Parent anchor point
+  position += vrb::Vector(aParentWorldWidth * parentAnchor.x() - aParentWorldWidth * 0.5f,
+                          aParentWorldHeight * parentAnchor.y(),
+                          0.0f);
+
+  transform.TranslateInPlace(position);
+  return aParentTransform.PostMultiply(transform);
+}
+
 }
\ No newline at end of file
@@ -6,12 +6,16 @@
 #ifndef VRBROWSER_WIDGET_PLACEMENT_DOT_H
 #define VRBROWSER_WIDGET_PLACEMENT_DOT_H
 
+#include "vrb/Forward.h"
 #include "vrb/Vector.h"
 #include "vrb/MacroUtils.h"
 #include <jni.h>
 
 namespace crow {
 
+// World units per widget pixel.
+static const float kWorldDPIRatio = 18.0f/720.0f;
+
 class WidgetPlacement;
 typedef std::shared_ptr<WidgetPlacement> WidgetPlacementPtr;
 
@@ -27,7 +31,20 @@ struct WidgetPlacement {
   vrb::Vector parentAnchor;
   float worldScale;
 
+  static WidgetPlacementPtr Create();
   static WidgetPlacementPtr FromJava(JNIEnv* aEnv, jobject& aObject);
+  // Decodes into existing storage so callers can reuse one placement.
+  // Returns false if aObject is null.
+  static bool FromJava(JNIEnv* aEnv, jobject aObject, WidgetPlacement& aResult);
+  // Resolves the Java field IDs once. The class is loaded through the activity
+  // class loader because FindClass on a native thread only sees system classes.
+  static void InitializeJava(JNIEnv* aEnv, jobject aActivity);
+  static void ShutdownJava();
+  // Returns the world transform of a widget with the given world size placed
+  // relative to its parent widget.
+  vrb::Matrix GetTransform(const vrb::Matrix& aParentTransform,
+                           const float aParentWorldWidth, const float aParentWorldHeight,
+                           const float aWorldWidth, const float aWorldHeight) const;
 private:
   WidgetPlacement() {};
   VRB_NO_DEFAULTS(WidgetPlacement)
@@ -11,9 +11,11 @@
 #include "vrb/Logger.h"
 #include "vrb/GLError.h"
 #include "BrowserEGLContext.h"
+#include "GLStateCache.h"
+#include "RunnableQueue.h"
+#include "Trace.h"
 #include <android_native_app_glue.h>
 #include <cstdlib>
-#include <vrb/RunnableQueue.h>
 #if defined(OCULUSVR)
 #include "DeviceDelegateOculusVR.h"
 #elif defined(SNAPDRAGONVR)
@@ -52,7 +54,7 @@ GetAssetManager(JNIEnv *aEnv, jobject aActivity) {
 
 
 struct AppContext {
-  vrb::RunnableQueuePtr mQueue;
+  RunnableQueuePtr mQueue;
   BrowserWorldPtr mWorld;
   BrowserEGLContextPtr mEgl;
   PlatformDeviceDelegatePtr mDevice;
@@ -75,8 +77,9 @@ CommandCallback(android_app *aApp, int32_t aCmd) {
         ctx->mEgl = BrowserEGLContext::Create();
         ctx->mEgl->Initialize(aApp->window);
         ctx->mEgl->MakeCurrent();
-        VRB_GL_CHECK(glEnable(GL_DEPTH_TEST));
-        VRB_GL_CHECK(glEnable(GL_CULL_FACE));
+        GLStateCache::Invalidate();
+        GLStateCache::Enable(GL_DEPTH_TEST);
+        GLStateCache::Enable(GL_CULL_FACE);
         ctx->mWorld->InitializeGL();
       } else {
         ctx->mEgl->UpdateNativeWindow(aApp->window);
@@ -193,7 +196,7 @@ android_main(android_app *aAppState) {
 
   // Create Browser context
   sAppContext = std::make_shared<AppContext>();
-  sAppContext->mQueue = vrb::RunnableQueue::Create(aAppState->activity->vm);
+  sAppContext->mQueue = RunnableQueue::Create(aAppState->activity->vm);
   sAppContext->mWorld = BrowserWorld::Create();
 
   // Create device delegate
@@ -243,9 +246,15 @@ android_main(android_app *aAppState) {
     if (sAppContext->mEgl) {
       sAppContext->mEgl->MakeCurrent();
     }
-    sAppContext->mQueue->ProcessRunnables();
+    {
+      CROW_TRACE_SCOPE("RunnableQueue::ProcessRunnables");
+      // Without a frame to protect the whole queue is drained.
+      const int64_t budget = sAppContext->mDevice->IsInVRMode() ?
+          sAppContext->mWorld->GetRunnableBudget() : RunnableQueue::kNoBudget;
+      sAppContext->mQueue->ProcessRunnables(budget);
+      CROW_TRACE_COUNTER("RunnableQueueDepth", sAppContext->mQueue->GetDepth());
+    }
     if (!sAppContext->mWorld->IsPaused() && sAppContext->mDevice->IsInVRMode()) {
-      VRB_GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
       sAppContext->mWorld->Draw();
     }
   }
@@ -6,6 +6,8 @@
 #include "DeviceDelegateNoAPI.h"
 #include "ElbowModel.h"
 #include "GestureDelegate.h"
+#include "GLStateCache.h"
+#include "Trace.h"
 
 #include "vrb/CameraSimple.h"
 #include "vrb/Color.h"
@@ -102,6 +104,21 @@ DeviceDelegateNoAPI::GetControllerModelName(const int32_t) const {
   return name;
 }
 
+float
+DeviceDelegateNoAPI::GetDisplayPeriod() const {
+  return 1.0f / 60.0f;
+}
+
+int64_t
+DeviceDelegateNoAPI::GetPredictedDisplayTime() const {
+  return 0;
+}
+
+bool
+DeviceDelegateNoAPI::GetHiddenAreaMesh(const CameraEnum aWhich, std::vector<float>& aVertices) const {
+  return false;
+}
+
 void
 DeviceDelegateNoAPI::ProcessEvents() {
   m.camera->SetTransform(m.headingMatrix.Translate(m.position));
@@ -109,10 +126,11 @@ DeviceDelegateNoAPI::ProcessEvents() {
 
 void
 DeviceDelegateNoAPI::StartFrame() {
-  VRB_GL_CHECK(glClearColor(m.clearColor.Red(), m.clearColor.Green(), m.clearColor.Blue(), m.clearColor.Alpha()));
-  VRB_GL_CHECK(glEnable(GL_DEPTH_TEST));
-  VRB_GL_CHECK(glEnable(GL_CULL_FACE));
-  VRB_GL_CHECK(glEnable(GL_BLEND));
+  CROW_TRACE_SCOPE("DeviceDelegateNoAPI::StartFrame");
+  GLStateCache::ClearColor(m.clearColor.Red(), m.clearColor.Green(), m.clearColor.Blue(), m.clearColor.Alpha());
+  GLStateCache::Enable(GL_DEPTH_TEST);
+  GLStateCache::Enable(GL_CULL_FACE);
+  GLStateCache::Enable(GL_BLEND);
   VRB_GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 }
 
@@ -121,8 +139,14 @@ DeviceDelegateNoAPI::BindEye(const CameraEnum) {
   // noop
 }
 
+bool
+DeviceDelegateNoAPI::SetRenderScale(const float aScale) {
+  return false;
+}
+
 void
 DeviceDelegateNoAPI::EndFrame() {
+  CROW_TRACE_SCOPE("DeviceDelegateNoAPI::EndFrame");
   // noop
 }
 
@@ -135,7 +159,7 @@ DeviceDelegateNoAPI::SetViewport(const int aWidth, const int aHeight) {
     m.camera->SetFieldOfView(-1.0f, 60.0f);
   }
   VRB_LOG("********* SETTING VIEWPORT %d %d", aWidth, aHeight);
-  VRB_GL_CHECK(glViewport(0, 0, aWidth, aHeight));
+  GLStateCache::Viewport(0, 0, aWidth, aHeight);
 }
 
 
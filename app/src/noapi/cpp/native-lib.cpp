@@ -8,6 +8,7 @@
 
 #include "BrowserWorld.h"
 #include "DeviceDelegateNoAPI.h"
+#include "GLStateCache.h"
 #include "vrb/GLError.h"
 #include "vrb/Logger.h"
 
@@ -40,6 +41,8 @@ JNI_METHOD(void, activityResumed)
 
 JNI_METHOD(void, activityCreated)
 (JNIEnv* aEnv, jobject aActivity, jobject aAssetManager) {
+  // Called from onSurfaceCreated, with a new GL context current.
+  crow::GLStateCache::Invalidate();
   if (!sDevice) {
     sDevice = crow::DeviceDelegateNoAPI::Create(sWorld->GetWeakContext());
   }
@@ -5,7 +5,12 @@
 
 #include "DeviceDelegateOculusVR.h"
 #include "ElbowModel.h"
+#include "EyeBufferHints.h"
 #include "BrowserEGLContext.h"
+#include "ClockGovernor.h"
+#include "FrameTimings.h"
+#include "GLStateCache.h"
+#include "Trace.h"
 
 #include <android_native_app_glue.h>
 #include <EGL/egl.h>
@@ -29,6 +34,10 @@
 
 namespace crow {
 
+const int32_t kMinClockLevel = 0;
+const int32_t kMaxClockLevel = 4;
+const int32_t kEyeBufferSamples = 2;
+
 class OculusEyeSwapChain;
 
 typedef std::shared_ptr<OculusEyeSwapChain> OculusEyeSwapChainPtr;
@@ -59,7 +68,7 @@ struct OculusEyeSwapChain {
       VRB_GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
 
       vrb::FBO::Attributes attributes;
-      attributes.samples = 2;
+      attributes.samples = kEyeBufferSamples;
       VRB_GL_CHECK(fbo->SetTextureHandle(texture, aWidth, aHeight, attributes));
       if (fbo->IsValid()) {
         fbos.push_back(fbo);
@@ -93,6 +102,8 @@ struct DeviceDelegateOculusVR::State {
   ovrTracking2 predictedTracking = {};
   uint32_t renderWidth = 0;
   uint32_t renderHeight = 0;
+  float renderScale = 1.0f;
+  float displayPeriod = 1.0f / 60.0f;
   vrb::Color clearColor;
   float near = 0.1f;
   float far = 100.f;
@@ -101,6 +112,9 @@ struct DeviceDelegateOculusVR::State {
   vrb::Matrix controllerTransform = vrb::Matrix::Identity();
   ovrInputStateTrackedRemote controllerState = {};
   crow::ElbowModelPtr elbow;
+  ClockGovernorPtr clocks;
+  int64_t frameStart = 0;
+  int64_t lastFrameStart = 0;
   ElbowModel::HandEnum hand = ElbowModel::HandEnum::Right;
   ControllerDelegatePtr controller;
 
@@ -123,6 +137,7 @@ struct DeviceDelegateOculusVR::State {
 
   void Initialize() {
     elbow = ElbowModel::Create();
+    clocks = ClockGovernor::Create();
     vrb::ContextPtr localContext = context.lock();
 
     java.Vm = app->activity->vm;
@@ -143,6 +158,10 @@ struct DeviceDelegateOculusVR::State {
                                                         VRAPI_SYS_PROP_SUGGESTED_EYE_TEXTURE_WIDTH) * 1.5f);
     renderHeight = (uint32_t)(vrapi_GetSystemPropertyInt(&java,
                                                          VRAPI_SYS_PROP_SUGGESTED_EYE_TEXTURE_HEIGHT) * 1.5f);
+    const int32_t refreshRate = vrapi_GetSystemPropertyInt(&java, VRAPI_SYS_PROP_DISPLAY_REFRESH_RATE);
+    if (refreshRate > 0) {
+      displayPeriod = 1.0f / (float)refreshRate;
+    }
 
     for (int i = 0; i < VRAPI_EYE_COUNT; ++i) {
       cameras[i] = vrb::CameraEye::Create(context);
@@ -303,13 +322,31 @@ DeviceDelegateOculusVR::GetControllerModelName(const int32_t aModelIndex) const
   return aModelIndex == 0 ? name : "";
 }
 
+float
+DeviceDelegateOculusVR::GetDisplayPeriod() const {
+  return m.displayPeriod;
+}
+
+int64_t
+DeviceDelegateOculusVR::GetPredictedDisplayTime() const {
+  // VrApi time is CLOCK_MONOTONIC in seconds, the same clock as FrameTimings.
+  return (int64_t)(m.predictedDisplayTime * 1.0e9);
+}
+
+bool
+DeviceDelegateOculusVR::GetHiddenAreaMesh(const CameraEnum aWhich, std::vector<float>& aVertices) const {
+  return false;
+}
+
 void
 DeviceDelegateOculusVR::ProcessEvents() {
-
+  m.lastFrameStart = m.frameStart;
+  m.frameStart = FrameTimings::Now();
 }
 
 void
 DeviceDelegateOculusVR::StartFrame() {
+  CROW_TRACE_SCOPE("DeviceDelegateOculusVR::StartFrame");
   if (!m.ovr) {
     VRB_LOG("StartFrame called while not in VR mode");
     return;
@@ -348,7 +385,7 @@ DeviceDelegateOculusVR::StartFrame() {
   m.cameras[VRAPI_EYE_RIGHT]->SetHeadTransform(head);
 
   m.UpdateControllers(head);
-  VRB_GL_CHECK(glClearColor(m.clearColor.Red(), m.clearColor.Green(), m.clearColor.Blue(), m.clearColor.Alpha()));
+  GLStateCache::ClearColor(m.clearColor.Red(), m.clearColor.Green(), m.clearColor.Blue(), m.clearColor.Alpha());
 }
 
 void
@@ -365,6 +402,7 @@ DeviceDelegateOculusVR::BindEye(const CameraEnum aWhich) {
   }
 
   if (m.currentFBO) {
+    EyeBufferHints::EndPass((GLsizei)m.renderWidth, (GLsizei)m.renderHeight, kEyeBufferSamples);
     m.currentFBO->Unbind();
   }
 
@@ -374,20 +412,29 @@ DeviceDelegateOculusVR::BindEye(const CameraEnum aWhich) {
 
   if (m.currentFBO) {
     m.currentFBO->Bind();
-    VRB_GL_CHECK(glViewport(0, 0, m.renderWidth, m.renderHeight));
-    VRB_GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+    GLStateCache::Viewport(0, 0, (GLsizei)(m.renderWidth * m.renderScale),
+                           (GLsizei)(m.renderHeight * m.renderScale));
+    EyeBufferHints::BeginPass();
   } else {
     VRB_LOG("No Swap chain FBO found");
   }
 }
 
+bool
+DeviceDelegateOculusVR::SetRenderScale(const float aScale) {
+  m.renderScale = aScale;
+  return true;
+}
+
 void
 DeviceDelegateOculusVR::EndFrame() {
+  CROW_TRACE_SCOPE("DeviceDelegateOculusVR::EndFrame");
   if (!m.ovr) {
     VRB_LOG("EndFrame called while not in VR mode");
     return;
   }
   if (m.currentFBO) {
+    EyeBufferHints::EndPass((GLsizei)m.renderWidth, (GLsizei)m.renderHeight, kEyeBufferSamples);
     m.currentFBO->Unbind();
     m.currentFBO.reset();
   }
@@ -402,6 +449,22 @@ DeviceDelegateOculusVR::EndFrame() {
     layer.Textures[i].SwapChainIndex = swapChainIndex;
     layer.Textures[i].TexCoordsFromTanAngles = ovrMatrix4f_TanAngleMatrixFromProjection(
         &m.predictedTracking.Eye[i].ProjectionMatrix);
+    // Only the lower left renderScale of the image was rendered.
+    for (int row = 0; row < 2; ++row) {
+      for (int column = 0; column < 4; ++column) {
+        layer.Textures[i].TexCoordsFromTanAngles.M[row][column] *= m.renderScale;
+      }
+    }
+    layer.Textures[i].TextureRect = {0.0f, 0.0f, m.renderScale, m.renderScale};
+  }
+
+  // Measured before the submit, which may block until vsync.
+  ClockGovernor::Sample sample;
+  sample.cpuTime = FrameTimings::Now() - m.frameStart;
+  sample.gpuTime = -1; // VrApi does not report per-frame GPU time.
+  sample.frameInterval = m.lastFrameStart > 0 ? m.frameStart - m.lastFrameStart : 0;
+  if (m.clocks->Update(sample, m.displayPeriod)) {
+    vrapi_SetClockLevels(m.ovr, m.clocks->GetCPULevel(), m.clocks->GetGPULevel());
   }
 
   ovrSubmitFrameDescription2 frameDesc = {};
@@ -416,6 +479,7 @@ DeviceDelegateOculusVR::EndFrame() {
   frameDesc.Layers = layers;
 
   vrapi_SubmitFrame2(m.ovr, &frameDesc);
+  GLStateCache::Invalidate();
 }
 
 void
@@ -441,7 +505,10 @@ DeviceDelegateOculusVR::EnterVR(const crow::BrowserEGLContext& aEGLContext) {
   if (!m.ovr) {
     VRB_LOG("Entering VR mode failed");
   } else {
-    vrapi_SetClockLevels(m.ovr, 4, 4);
+    // Start at full clocks and let the governor lower them to fit the load.
+    m.clocks->SetRange(kMinClockLevel, kMaxClockLevel, kMaxClockLevel);
+    m.lastFrameStart = m.frameStart = 0;
+    vrapi_SetClockLevels(m.ovr, m.clocks->GetCPULevel(), m.clocks->GetGPULevel());
     vrapi_SetPerfThread(m.ovr, VRAPI_PERF_THREAD_TYPE_MAIN, gettid());
     vrapi_SetPerfThread(m.ovr, VRAPI_PERF_THREAD_TYPE_RENDERER, gettid());
   }
@@ -5,7 +5,12 @@
 
 #include "DeviceDelegateSVR.h"
 #include "ElbowModel.h"
+#include "EyeBufferHints.h"
 #include "BrowserEGLContext.h"
+#include "ClockGovernor.h"
+#include "FrameTimings.h"
+#include "GLStateCache.h"
+#include "Trace.h"
 
 #include <android_native_app_glue.h>
 #include <EGL/egl.h>
@@ -28,6 +33,12 @@ namespace crow {
 
 const int32_t kHeadControllerId = 0;
 const int32_t kControllerId = 1;
+const int32_t kEyeBufferSamples = 2;
+// Clock governor levels, slowest first.
+const svrPerfLevel kPerfLevels[] = {
+  svrPerfLevel::kPerfMinimum, svrPerfLevel::kPerfMedium, svrPerfLevel::kPerfMaximum
+};
+const int32_t kPerfLevelCount = sizeof(kPerfLevels) / sizeof(kPerfLevels[0]);
 
 class SVREyeSwapChain;
 typedef std::shared_ptr<SVREyeSwapChain> SVREyeSwapChainPtr;
@@ -58,7 +69,7 @@ struct SVREyeSwapChain {
                              GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
 
       vrb::FBO::Attributes attributes;
-      attributes.samples = 2;
+      attributes.samples = kEyeBufferSamples;
       VRB_GL_CHECK(fbo->SetTextureHandle(textureId, aWidth, aHeight, attributes));
       if (fbo->IsValid()) {
         textures.push_back(textureId);
@@ -90,10 +101,13 @@ struct DeviceDelegateSVR::State {
   int32_t currentEye = -1;
   vrb::CameraEyePtr cameras[2];
   uint32_t frameIndex = 0;
+  int64_t predictedDisplayTime = 0;
   svrHeadPoseState predictedPose = {};
   svrLayoutCoords layoutCoords = {};
   uint32_t renderWidth = 0;
   uint32_t renderHeight = 0;
+  float renderScale = 1.0f;
+  float displayPeriod = 1.0f / 60.0f;
   vrb::Color clearColor;
   float near = 0.1f;
   float far = 100.f;
@@ -102,6 +116,9 @@ struct DeviceDelegateSVR::State {
   svrControllerState headControllerState = {};
   vrb::Matrix controllerTransform = vrb::Matrix::Identity();
   crow::ElbowModelPtr elbow;
+  ClockGovernorPtr clocks;
+  int64_t frameStart = 0;
+  int64_t lastFrameStart = 0;
   bool usingHeadTrackingInput = false;
   float scrollDelta = 0.0f;
   bool headControllerCreated = false;
@@ -171,6 +188,9 @@ struct DeviceDelegateSVR::State {
     renderHeight = (uint32_t) info.targetEyeHeightPixels;
     near = info.leftEyeFrustum.near;
     far = info.leftEyeFrustum.far;
+    if (info.displayRefreshRateHz > 0.0f) {
+      displayPeriod = 1.0f / info.displayRefreshRateHz;
+    }
 
     for (int i = 0; i < kNumEyes; ++i) {
       cameras[i] = vrb::CameraEye::Create(context);
@@ -184,6 +204,7 @@ struct DeviceDelegateSVR::State {
     UpdatePerspective(info);
     UpdateLayoutCoords(0.f, 0.f, 1.f, 1.f);
     elbow = crow::ElbowModel::Create();
+    clocks = ClockGovernor::Create();
   }
 
   void Shutdown() {
@@ -340,13 +361,30 @@ DeviceDelegateSVR::GetControllerModelName(const int32_t aModelIndex) const {
   return aModelIndex == 0 ? name : "";
 }
 
+float
+DeviceDelegateSVR::GetDisplayPeriod() const {
+  return m.displayPeriod;
+}
+
+int64_t
+DeviceDelegateSVR::GetPredictedDisplayTime() const {
+  return m.predictedDisplayTime;
+}
+
+bool
+DeviceDelegateSVR::GetHiddenAreaMesh(const CameraEnum aWhich, std::vector<float>& aVertices) const {
+  return false;
+}
+
 void
 DeviceDelegateSVR::ProcessEvents() {
-
+  m.lastFrameStart = m.frameStart;
+  m.frameStart = FrameTimings::Now();
 }
 
 void
 DeviceDelegateSVR::StartFrame() {
+  CROW_TRACE_SCOPE("DeviceDelegateSVR::StartFrame");
   if (!m.isInVRMode) {
     VRB_LOG("StartFrame called while not in VR mode");
     return;
@@ -354,6 +392,8 @@ DeviceDelegateSVR::StartFrame() {
 
   m.frameIndex++;
   float predictedTime = svrGetPredictedDisplayTime();
+  // svrGetPredictedDisplayTime() is milliseconds from now.
+  m.predictedDisplayTime = FrameTimings::Now() + (int64_t)(predictedTime * 1.0e6f);
   m.predictedPose = svrGetPredictedHeadPose(predictedTime);
 
   vrb::Matrix head = vrb::Matrix::Identity();
@@ -376,7 +416,7 @@ DeviceDelegateSVR::StartFrame() {
   m.cameras[kRightEye]->SetHeadTransform(head);
 
   m.UpdateControllers(head);
-  VRB_GL_CHECK(glClearColor(m.clearColor.Red(), m.clearColor.Green(), m.clearColor.Blue(), m.clearColor.Alpha()));
+  GLStateCache::ClearColor(m.clearColor.Red(), m.clearColor.Green(), m.clearColor.Blue(), m.clearColor.Alpha());
 }
 
 void
@@ -394,6 +434,7 @@ DeviceDelegateSVR::BindEye(const CameraEnum aWhich) {
 
 
   if (m.currentFBO) {
+    EyeBufferHints::EndPass((GLsizei)m.renderWidth, (GLsizei)m.renderHeight, kEyeBufferSamples);
     m.currentFBO->Unbind();
   }
 
@@ -409,15 +450,24 @@ DeviceDelegateSVR::BindEye(const CameraEnum aWhich) {
     m.currentFBO->Bind();
     m.currentEye = index;
     svrBeginEye((svrWhichEye) m.currentEye);
-    VRB_GL_CHECK(glViewport(0, 0, m.renderWidth, m.renderHeight));
-    VRB_GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+    GLStateCache::Viewport(0, 0, (GLsizei)(m.renderWidth * m.renderScale),
+                           (GLsizei)(m.renderHeight * m.renderScale));
+    EyeBufferHints::BeginPass();
   } else {
     VRB_LOG("No Swap chain FBO found");
   }
 }
 
+bool
+DeviceDelegateSVR::SetRenderScale(const float aScale) {
+  m.renderScale = aScale;
+  m.UpdateLayoutCoords(0.0f, 0.0f, aScale, aScale);
+  return true;
+}
+
 void
 DeviceDelegateSVR::EndFrame() {
+  CROW_TRACE_SCOPE("DeviceDelegateSVR::EndFrame");
   if (!m.isInVRMode) {
     VRB_LOG("EndFrame called while not in VR mode");
     return;
@@ -429,10 +479,20 @@ DeviceDelegateSVR::EndFrame() {
   }
 
   if (m.currentFBO) {
+    EyeBufferHints::EndPass((GLsizei)m.renderWidth, (GLsizei)m.renderHeight, kEyeBufferSamples);
     m.currentFBO->Unbind();
     m.currentFBO.reset();
   }
 
+  // Measured before the submit, which may block until vsync.
+  ClockGovernor::Sample sample;
+  sample.cpuTime = FrameTimings::Now() - m.frameStart;
+  sample.gpuTime = -1; // SVR does not report per-frame GPU time.
+  sample.frameInterval = m.lastFrameStart > 0 ? m.frameStart - m.lastFrameStart : 0;
+  if (m.clocks->Update(sample, m.displayPeriod)) {
+    svrSetPerformanceLevels(kPerfLevels[m.clocks->GetCPULevel()], kPerfLevels[m.clocks->GetGPULevel()]);
+  }
+
   svrFrameParams params = {};
   params.frameIndex = m.frameIndex;
   // Minimum number of vysnc events before displaying the frame (1=display refresh, 2=half refresh, etc...).
@@ -460,6 +520,7 @@ DeviceDelegateSVR::EndFrame() {
   }
 
   svrSubmitFrame(&params);
+  GLStateCache::Invalidate();
 }
 
 void
@@ -474,8 +535,12 @@ DeviceDelegateSVR::EnterVR(const crow::BrowserEGLContext& aEGLContext) {
 
   svrBeginParams params = {};
   params.mainThreadId = gettid();
-  params.cpuPerfLevel = svrPerfLevel::kPerfSystem;
-  params.gpuPerfLevel = svrPerfLevel::kPerfSystem;
+  // Start in the middle, close to what the system picks on its own, and let
+  // the governor move the clocks to fit the load.
+  m.clocks->SetRange(0, kPerfLevelCount - 1, kPerfLevelCount / 2);
+  m.lastFrameStart = m.frameStart = 0;
+  params.cpuPerfLevel = kPerfLevels[m.clocks->GetCPULevel()];
+  params.gpuPerfLevel = kPerfLevels[m.clocks->GetGPULevel()];
   params.nativeWindow = m.app->window;
   params.isProtectedContent = false;
 
@@ -32,9 +32,13 @@ public:
   void ReleaseControllerDelegate() override;
   int32_t GetControllerModelCount() const override;
   const std::string GetControllerModelName(const int32_t aModelIndex) const override;
+  float GetDisplayPeriod() const override;
+  int64_t GetPredictedDisplayTime() const override;
+  bool GetHiddenAreaMesh(const CameraEnum aWhich, std::vector<float>& aVertices) const override;
   void ProcessEvents() override;
   void StartFrame() override;
   void BindEye(const CameraEnum aWhich) override;
+  bool SetRenderScale(const float aScale) override;
   void EndFrame() override;
   // Custom methods for NativeActivity render loop based devices.
   void EnterVR(const crow::BrowserEGLContext& aEGLContext);
@@ -5,7 +5,10 @@
 
 #include "DeviceDelegateWaveVR.h"
 #include "ElbowModel.h"
+#include "EyeBufferHints.h"
 #include "GestureDelegate.h"
+#include "GLStateCache.h"
+#include "Trace.h"
 
 #include "vrb/CameraEye.h"
 #include "vrb/Color.h"
@@ -29,6 +32,7 @@
 namespace crow {
 
 static const int32_t kMaxControllerCount = 2;
+static const int32_t kEyeBufferSamples = 4;
 
 struct Controller {
   int32_t index;
@@ -95,7 +99,7 @@ struct DeviceDelegateWaveVR::State {
 
   void FillFBOQueue(void* aTextureQueue, std::vector<vrb::FBOPtr>& aFBOQueue) {
     vrb::FBO::Attributes attributes;
-    attributes.samples = 4;
+    attributes.samples = kEyeBufferSamples;
     for (int ix = 0; ix < WVR_GetTextureQueueLength(aTextureQueue); ix++) {
       vrb::FBOPtr fbo = vrb::FBO::Create(context);
       fbo->SetTextureHandle((GLuint)WVR_GetTexture(aTextureQueue, ix).id, renderWidth, renderHeight, attributes);
@@ -132,7 +136,7 @@ struct DeviceDelegateWaveVR::State {
     cameras[cameraIndex(CameraEnum::Right)] = vrb::CameraEye::Create(context);
     InitializeCameras();
     WVR_GetRenderTargetSize(&renderWidth, &renderHeight);
-    VRB_GL_CHECK(glViewport(0, 0, renderWidth, renderHeight));
+    GLStateCache::Viewport(0, 0, renderWidth, renderHeight);
     VRB_LOG("Recommended size is %ux%u", renderWidth, renderHeight);
     if (renderWidth == 0 || renderHeight == 0) {
       VRB_LOG("Please check Wave server configuration");
@@ -250,6 +254,22 @@ DeviceDelegateWaveVR::GetControllerModelName(const int32_t aModelIndex) const {
   return aModelIndex == 0 ? name : "";
 }
 
+float
+DeviceDelegateWaveVR::GetDisplayPeriod() const {
+  // The Wave SDK does not report its refresh rate; the Vive Focus runs at 75Hz.
+  return 1.0f / 75.0f;
+}
+
+int64_t
+DeviceDelegateWaveVR::GetPredictedDisplayTime() const {
+  return 0;
+}
+
+bool
+DeviceDelegateWaveVR::GetHiddenAreaMesh(const CameraEnum aWhich, std::vector<float>& aVertices) const {
+  return false;
+}
+
 void
 DeviceDelegateWaveVR::ProcessEvents() {
   WVR_Event_t event;
@@ -417,7 +437,8 @@ DeviceDelegateWaveVR::ProcessEvents() {
 
 void
 DeviceDelegateWaveVR::StartFrame() {
-  VRB_GL_CHECK(glClearColor(m.clearColor.Red(), m.clearColor.Green(), m.clearColor.Blue(), m.clearColor.Alpha()));
+  CROW_TRACE_SCOPE("DeviceDelegateWaveVR::StartFrame");
+  GLStateCache::ClearColor(m.clearColor.Red(), m.clearColor.Green(), m.clearColor.Blue(), m.clearColor.Alpha());
   static const vrb::Vector kAverageHeight(0.0f, 1.7f, 0.0f);
   m.leftFBOIndex = WVR_GetAvailableTextureIndex(m.leftTextureQueue);
   m.rightFBOIndex = WVR_GetAvailableTextureIndex(m.rightTextureQueue);
@@ -465,6 +486,7 @@ DeviceDelegateWaveVR::StartFrame() {
 void
 DeviceDelegateWaveVR::BindEye(const CameraEnum aWhich) {
   if (m.currentFBO) {
+    EyeBufferHints::EndPass((GLsizei)m.renderWidth, (GLsizei)m.renderHeight, kEyeBufferSamples);
     m.currentFBO->Unbind();
   }
   if (aWhich == CameraEnum::Left) {
@@ -476,16 +498,23 @@ DeviceDelegateWaveVR::BindEye(const CameraEnum aWhich) {
   }
   if (m.currentFBO) {
     m.currentFBO->Bind();
-    VRB_GL_CHECK(glViewport(0, 0, m.renderWidth, m.renderHeight));
-    VRB_GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+    GLStateCache::Viewport(0, 0, m.renderWidth, m.renderHeight);
+    EyeBufferHints::BeginPass();
   } else {
     VRB_LOG("No FBO found");
   }
 }
 
+bool
+DeviceDelegateWaveVR::SetRenderScale(const float aScale) {
+  return false;
+}
+
 void
 DeviceDelegateWaveVR::EndFrame() {
+  CROW_TRACE_SCOPE("DeviceDelegateWaveVR::EndFrame");
   if (m.currentFBO) {
+    EyeBufferHints::EndPass((GLsizei)m.renderWidth, (GLsizei)m.renderHeight, kEyeBufferSamples);
     m.currentFBO->Unbind();
     m.currentFBO = nullptr;
   }
@@ -502,6 +531,7 @@ DeviceDelegateWaveVR::EndFrame() {
   if (result != WVR_SubmitError_None) {
     VRB_LOG("Failed to submit right eye frame");
   }
+  GLStateCache::Invalidate();
 }
 
 bool
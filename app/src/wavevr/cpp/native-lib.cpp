@@ -16,14 +16,16 @@
 
 #include "BrowserWorld.h"
 #include "DeviceDelegateWaveVR.h"
+#include "RunnableQueue.h"
+#include "GLStateCache.h"
+#include "Trace.h"
 #include "vrb/Logger.h"
 #include "vrb/GLError.h"
-#include "vrb/RunnableQueue.h"
 
 using namespace crow;
 
 static bool sJavaInitialized = false;
-static vrb::RunnableQueuePtr sQueue;
+static RunnableQueuePtr sQueue;
 static BrowserWorldPtr sWorld;
 static DeviceDelegateWaveVRPtr sDevice;
 
@@ -63,9 +65,10 @@ int main(int argc, char *argv[]) {
   }
   sDevice = DeviceDelegateWaveVR::Create(sWorld->GetWeakContext());
   sWorld->RegisterDeviceDelegate(sDevice);
-  VRB_GL_CHECK(glEnable(GL_DEPTH_TEST));
-  VRB_GL_CHECK(glEnable(GL_CULL_FACE));
-  VRB_GL_CHECK(glEnable(GL_BLEND));
+  GLStateCache::Invalidate();
+  GLStateCache::Enable(GL_DEPTH_TEST);
+  GLStateCache::Enable(GL_CULL_FACE);
+  GLStateCache::Enable(GL_BLEND);
   // VRB_GL_CHECK(glDisable(GL_CULL_FACE));
   while(!sJavaInitialized) {
     sQueue->ProcessRunnables();
@@ -74,9 +77,12 @@ int main(int argc, char *argv[]) {
   sWorld->InitializeGL();
   sWorld->Resume();
   while (sDevice->IsRunning()) {
-    sQueue->ProcessRunnables();
+    {
+      CROW_TRACE_SCOPE("RunnableQueue::ProcessRunnables");
+      sQueue->ProcessRunnables(sWorld->GetRunnableBudget());
+      CROW_TRACE_COUNTER("RunnableQueueDepth", sQueue->GetDepth());
+    }
     //VRB_LOG("About to DRAW!");
-    VRB_GL_CHECK(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
     sWorld->Draw();
   }
   sWorld->ShutdownGL();
@@ -95,7 +101,7 @@ JNI_METHOD(void, initializeJava)
 }
 
 jint JNI_OnLoad(JavaVM* aVm, void*) {
-  sQueue = vrb::RunnableQueue::Create(aVm);
+  sQueue = RunnableQueue::Create(aVm);
   sWorld = BrowserWorld::Create();
   WVR_RegisterMain(main);
   return JNI_VERSION_1_6;